@@ -51,11 +51,40 @@ struct tmcc_stream_infos {
     struct stream_info stream_info[16];
 };
 
+/*
+ * Stream list from the TMCC of the ISDB-S3 carrier the demodulator is
+ * locked to. The ISDB-S TMCC register map is not known, so ISDB-S
+ * carriers report no streams.
+ */
+struct cxd2857_tmcc {
+    bool isdbs3;
+    u8 nr_streams;
+    struct tmcc_stream_infos streams;
+};
+
+/* one carrier found by cxd2857_scan() */
+struct cxd2857_scan_entry {
+    u32 frequency; //kHz
+    struct cxd2857_tmcc tmcc; //zeroed for ISDB-S, no stream ids
+};
+
+/* one channel found by cxd2857_scan_isdbt() */
+struct cxd2857_isdbt_scan_entry {
+    u32 frequency; //Hz
+    s32 strength; //0.001 dBm
+};
+
 #define CONFIG_DVB_CXD2878_MODULE
 #define CONFIG_DVB_CXD2878
 #if 1
 extern struct dvb_frontend *cxd2857_attach(const struct cxd2857_config *config,
 					   struct i2c_adapter *i2c);
+extern int cxd2857_get_tmcc(struct dvb_frontend *fe,
+			    struct cxd2857_tmcc *tmcc);
+extern int cxd2857_scan(struct dvb_frontend *fe, const u32 *freqs, int nr_freqs,
+			struct cxd2857_scan_entry *res, int max);
+extern int cxd2857_scan_isdbt(struct dvb_frontend *fe,
+			      struct cxd2857_isdbt_scan_entry *res, int max);
 #else
 static inline struct dvb_frontend *
 cxd2857_attach(const struct cxd2857_config *config, struct i2c_adapter *i2c)
@@ -63,6 +92,23 @@ cxd2857_attach(const struct cxd2857_config *config, struct i2c_adapter *i2c)
 	dev_warn(&i2c->dev, "%s: driver disabled by Kconfig\n", __func__);
 	return NULL;
 }
+static inline int cxd2857_get_tmcc(struct dvb_frontend *fe,
+				   struct cxd2857_tmcc *tmcc)
+{
+	return -ENODEV;
+}
+static inline int cxd2857_scan(struct dvb_frontend *fe, const u32 *freqs,
+			       int nr_freqs, struct cxd2857_scan_entry *res,
+			       int max)
+{
+	return -ENODEV;
+}
+static inline int cxd2857_scan_isdbt(struct dvb_frontend *fe,
+				     struct cxd2857_isdbt_scan_entry *res,
+				     int max)
+{
+	return -ENODEV;
+}
 
 #endif
 
@@ -0,0 +1,15 @@
+#ifndef _CXD2857_MATH_H_
+#define _CXD2857_MATH_H_
+
+/* 100 * log2(x) and 100 * log10(x) */
+u32 sony_math_log2(u32 x);
+u32 sony_math_log10(u32 x);
+
+/* CNR in 0.001 dB from the ISDB-S/ISDB-S3 CNR monitor register */
+s32 cxd2857_cnr_isdbs(u32 value);
+s32 cxd2857_cnr_isdbs3(u32 value);
+
+/* ISDB-T tuner RF gain in 0.01 dB, frequency in kHz */
+s32 cxd2857_rfgain_isdbt(u32 frequency, s32 maxagcreg_x140);
+
+#endif
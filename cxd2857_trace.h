@@ -0,0 +1,56 @@
+//SPX-License-Identifier: GPL-2.0-or-later
+/*
+ * Sony CXD2857 tracepoints
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cxd2857
+
+#if !defined(_CXD2857_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _CXD2857_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+#define CXD2857_PHASE_SET_FRONTEND	0
+#define CXD2857_PHASE_TUNER		1
+#define CXD2857_PHASE_TMCC_LOCK		2
+#define CXD2857_PHASE_TS_LOCK		3
+
+/* elapsed_us is measured from the start of set_frontend */
+TRACE_EVENT(cxd2857_tune_phase,
+	TP_PROTO(int i2c_nr, u8 addr, int phase, u32 frequency, u64 elapsed_us),
+	TP_ARGS(i2c_nr, addr, phase, frequency, elapsed_us),
+
+	TP_STRUCT__entry(
+		__field(int, i2c_nr)
+		__field(u8, addr)
+		__field(int, phase)
+		__field(u32, frequency)
+		__field(u64, elapsed_us)
+	),
+
+	TP_fast_assign(
+		__entry->i2c_nr = i2c_nr;
+		__entry->addr = addr;
+		__entry->phase = phase;
+		__entry->frequency = frequency;
+		__entry->elapsed_us = elapsed_us;
+	),
+
+	TP_printk("i2c-%d demod=0x%02x freq=%ukHz %s elapsed=%lluus",
+		  __entry->i2c_nr, __entry->addr, __entry->frequency,
+		  __print_symbolic(__entry->phase,
+			{ CXD2857_PHASE_SET_FRONTEND,	"set_frontend" },
+			{ CXD2857_PHASE_TUNER,		"tuner_programmed" },
+			{ CXD2857_PHASE_TMCC_LOCK,	"tmcc_lock" },
+			{ CXD2857_PHASE_TS_LOCK,	"ts_lock" }),
+		  __entry->elapsed_us)
+);
+
+#endif /* _CXD2857_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE cxd2857_trace
+#include <trace/define_trace.h>
@@ -14,11 +14,66 @@
 #include <linux/types.h>
 #include <media/dvb_frontend.h>
 #include <linux/mutex.h>
+#include <linux/hash.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "cxd2857.h"
 #include "cxd2857_priv.h"
+#include "cxd2857_math.h"
+
+#define CREATE_TRACE_POINTS
+#include "cxd2857_trace.h"
 
 static LIST_HEAD(cxdlist);
+static DEFINE_MUTEX(cxdlist_lock); //frontends may attach concurrently
+
+#define CXD2878_BATCH_MSGS	64
+#define CXD2878_BATCH_BUF	512
+
+#define CXD2878_REGCACHE_BITS	5
+
+#define CXD2878_LOCK_POLL_MIN	msecs_to_jiffies(10)
+#define CXD2878_LOCK_POLL_MAX	(HZ / 4)
+
+/* scan: AGC lock time of an empty channel, TMCC lock time of each system */
+#define CXD2878_SCAN_AGC_MS	100
+#define CXD2878_SCAN_ISDBS_MS	400
+#define CXD2878_SCAN_ISDBS3_MS	600
+/* ISDB-T scan: UHF channels 13-62, tuner settle time, lock time */
+#define CXD2878_SCAN_UHF_FIRST	13
+#define CXD2878_SCAN_UHF_LAST	62
+#define CXD2878_SCAN_RSSI_MS	10
+#define CXD2878_SCAN_ISDBT_MS	1500
+
+static int isdbt_scan_rssi_dbm = -85;
+module_param(isdbt_scan_rssi_dbm, int, 0644);
+MODULE_PARM_DESC(isdbt_scan_rssi_dbm,
+		 "ISDB-T scan: only try to lock channels above this RF level (default -85)");
+
+static unsigned int stats_interval_ms = 1000;
+module_param(stats_interval_ms, uint, 0644);
+MODULE_PARM_DESC(stats_interval_ms,
+		 "signal statistics refresh interval, 0 = read on every status poll (default 1000)");
+
+static unsigned int gate_settle_ms = 20;
+module_param(gate_settle_ms, uint, 0644);
+MODULE_PARM_DESC(gate_settle_ms,
+		 "delay after opening the tuner i2c repeater (default 20)");
+
+static unsigned int gate_hold_ms = 100;
+module_param(gate_hold_ms, uint, 0644);
+MODULE_PARM_DESC(gate_hold_ms,
+		 "keep the tuner i2c repeater open this long after the last access (default 100)");
+
+struct cxd2878_regcache_entry {
+	u8 addr;
+	u8 bank;
+	u8 reg;
+	u8 val;
+	bool valid;
+};
 
 struct cxd_base {
 	struct list_head cxdlist;
@@ -27,6 +82,7 @@ struct cxd_base {
 	u8 adr; //
 	u32 count; //
 	struct cxd2857_config config;
+	struct cxd2878_dev *gate_dev; //repeater open, protected by i2c_lock
 };
 
 enum sony_tuner_state_t {
@@ -55,9 +111,59 @@ struct cxd2878_dev {
 
 	u32 atscNoSignalThresh;
 	u32 atscSignalThresh;
-	u32 tune_time;
+	unsigned long tune_time;
+	u32 tuned_frequency; //kHz, 0 if the tuner is not programmed
+
+	unsigned long lock_poll; //jiffies, 0 once locked or timed out
+	ktime_t tune_start; //for tracing
+	bool ts_locked;
+
+	struct dentry *debugfs;
+
+	/*
+	 * fe_in_use from the frontend init to sleep op, scanning while a
+	 * cxd2857_scan*() owns the demodulator; both protected by i2c_lock
+	 */
+	bool fe_in_use;
+	bool scanning;
+	/* set_frontend dropped i2c_lock to wait for the TMCC lock */
+	bool tmcc_waiting;
+	u32 scan_symbol_rate;
+	u32 scan_bandwidth_hz;
+
+	/* tuner i2c repeater, protected by i2c_lock, see cxd2878_gate_get() */
+	bool gate_open;
+	int gate_users;
+	struct delayed_work gate_work;
+
+	/* signal statistics refreshed by stats_work, protected by i2c_lock */
+	struct delayed_work stats_work;
+	struct dtv_fe_stats strength;
+	struct dtv_fe_stats cnr;
+	struct dtv_fe_stats post_bit_error;
+	struct dtv_fe_stats post_bit_count;
+
+	/* selected bank of slvt and slvx, -1 if not known */
+	s16 bank[2];
+	/* values of read-modify-write registers, see cxd2878_rdc() */
+	struct cxd2878_regcache_entry regcache[1 << CXD2878_REGCACHE_BITS];
+
+	/* queued register writes, see cxd2878_batch_begin() */
+	int batch_depth;
+	int batch_err;
+	int batch_nmsg;
+	int batch_len;
+	struct i2c_msg batch_msg[CXD2878_BATCH_MSGS];
+	u8 batch_buf[CXD2878_BATCH_BUF];
 };
 
+static void cxd2878_trace_phase(struct cxd2878_dev *dev, int phase)
+{
+	trace_cxd2857_tune_phase(i2c_adapter_id(dev->base->i2c), dev->slvt,
+				 phase, dev->fe.dtv_property_cache.frequency,
+				 ktime_us_delta(ktime_get(), dev->tune_start));
+}
+
 static struct sony_freia_terr_adjust_param_t
 	g_terr_param_table_cxd2857[SONY_FREIA_TERR_TV_SYSTEM_NUM] = {
 		[SONY_FREIA_DTV_ISDBT_6] = { AUTO, 0x07, 0x0d, 0x0d, 0x0d, 0x03,
@@ -71,73 +177,186 @@ static struct sony_freia_terr_adjust_param_t
 					     OFFSET(-7), AUTO, AUTO },
 	};
 
-static const u8 log2LookUp[] = {
-	0,  /* 0 */ 4, /* 0.04439 */
-	9,  /* 0.08746 */ 13, /* 0.12928 */
-	17, /* 0.16993 */ 21, /* 0.20945 */
-	25, /* 0.24793 */ 29, /* 0.28540 */
-	32, /* 0.32193 */ 36, /* 0.35755 */
-	39, /* 0.39232 */ 43, /* 0.42627 */
-	46, /* 0.45943 */ 49, /* 0.49185 */
-	52, /* 0.52356 */ 55, /* 0.55249 */
-	58, /* 0.58496 */ 61, /* 0.61471 */
-	64, /* 0.64386 */ 67, /* 0.67246 */
-	70, /* 0.70044 */ 73, /* 0.72792 */
-	75, /* 0.75489 */ 78, /* 0.78136 */
-	81, /* 0.80736 */ 83, /* 0.83289 */
-	86, /* 0.85798 */ 88, /* 0.88264 */
-	91, /* 0.90689 */ 93, /* 0.93074 */
-	95, /* 0.95420 */ 98 /* 0.97728 */
-};
+static s32 sony_Convert2SComplement(u32 value, u32 bitlen)
+{
+	if ((bitlen == 0) || (bitlen >= 32)) {
+		return (s32)value;
+	}
+
+	if (value & (u32)(1 << (bitlen - 1))) {
+		/* minus value */
+		return (s32)(MASKUPPER(32 - bitlen) | value);
+	} else {
+		/* plus value */
+		return (s32)(MASKLOWER(bitlen) & value);
+	}
+}
+/*
+ * Register cache: the demodulator slaves have a bank select register at
+ * 0x00, so the selected bank is tracked and selecting it again is
+ * skipped. Configuration registers read by read-modify-write sequences
+ * are kept in a small hash (slave, bank, reg) and updated by every
+ * write through cxd2878_wrm(); status registers are always read from
+ * the chip with cxd2878_rdm(). Only the registers of cxd2878_static_regs
+ * are cached, everything else may be changed by the chip itself.
+ */
+static s16 *cxd2878_bank_slot(struct cxd2878_dev *dev, u8 addr)
+{
+	if (addr == dev->slvt)
+		return &dev->bank[0];
+	if (addr == dev->slvx)
+		return &dev->bank[1];
+	return NULL;
+}
+/*the tuner has no banks*/
+static int cxd2878_cur_bank(struct cxd2878_dev *dev, u8 addr)
+{
+	s16 *slot = cxd2878_bank_slot(dev, addr);
 
-static u32 sony_math_log2(u32 x)
+	return slot ? *slot : 0;
+}
+/*
+ * TS/TLV output configuration, only ever changed by the driver. Not
+ * listed on purpose: the tuner registers (0x67 and the others behind the
+ * repeater are updated by the tuner sequencer) and the SLV-T bank 00h
+ * state registers 80h, D3h, DAh and DEh.
+ */
+static const struct {
+	bool slvx;
+	u8 bank;
+	u8 reg;
+} cxd2878_static_regs[] = {
+	{ false, 0x00, 0x32 }, { false, 0x00, 0x33 }, { false, 0x00, 0x81 },
+	{ false, 0x00, 0xa9 }, { false, 0x00, 0xc4 }, { false, 0x00, 0xd1 },
+	{ false, 0x01, 0xc1 }, { false, 0x01, 0xc8 }, { false, 0x01, 0xcc },
+	{ false, 0x01, 0xcf }, { false, 0x01, 0xe7 }, { false, 0x01, 0xea },
+	{ false, 0x10, 0x66 }, { false, 0x40, 0x66 }, { false, 0x56, 0x83 },
+	{ false, 0xa0, 0xb9 },
+	{ true, 0x00, 0x81 }, { true, 0x00, 0x82 }, { true, 0x00, 0xa5 },
+};
+static bool cxd2878_reg_volatile(struct cxd2878_dev *dev, u8 addr, u8 bank,
+				 u8 reg)
 {
-	u8 count = 0;
-	u8 index = 0;
-	u32 xval = x;
+	int i;
+
+	if (addr != dev->slvt && addr != dev->slvx)
+		return true;
 
-	/* Get the MSB position. */
-	for (x >>= 1; x > 0; x >>= 1) {
-		count++;
+	for (i = 0; i < ARRAY_SIZE(cxd2878_static_regs); i++)
+		if (cxd2878_static_regs[i].slvx == (addr == dev->slvx) &&
+		    cxd2878_static_regs[i].bank == bank &&
+		    cxd2878_static_regs[i].reg == reg)
+			return false;
+	return true;
+}
+static struct cxd2878_regcache_entry *
+cxd2878_regcache_slot(struct cxd2878_dev *dev, u8 addr, u8 bank, u8 reg)
+{
+	return &dev->regcache[hash_32(addr << 16 | bank << 8 | reg,
+				      CXD2878_REGCACHE_BITS)];
+}
+static void cxd2878_regcache_invalidate(struct cxd2878_dev *dev)
+{
+	memset(dev->regcache, 0, sizeof(dev->regcache));
+	dev->bank[0] = -1;
+	dev->bank[1] = -1;
+}
+/*a write of len bytes at reg has been issued*/
+static void cxd2878_regcache_write(struct cxd2878_dev *dev, u8 addr, u8 reg,
+				   const u8 *buf, u8 len)
+{
+	struct cxd2878_regcache_entry *e;
+	s16 *slot = cxd2878_bank_slot(dev, addr);
+	int bank, i;
+
+	if (slot && reg == 0x00) {
+		*slot = buf[0];
+		reg++;
+		buf++;
+		len--;
 	}
 
-	x = count * 100;
+	/* clear all registers */
+	if (addr == dev->slvx && reg <= 0x02 && reg + len > 0x02) {
+		cxd2878_regcache_invalidate(dev);
+		return;
+	}
 
-	if (count > 0) {
-		if (count <= MAX_BIT_PRECISION) {
-			/* Mask the bottom bits. */
-			index = (u8)(xval << (MAX_BIT_PRECISION - count)) &
-				FRAC_BITMASK;
-			x += log2LookUp[index];
-		} else {
-			/* Mask the bits just below the radix. */
-			index = (u8)(xval >> (count - MAX_BIT_PRECISION)) &
-				FRAC_BITMASK;
-			x += log2LookUp[index];
-		}
+	bank = cxd2878_cur_bank(dev, addr);
+	if (bank < 0) {
+		/* unknown target, forget everything of this slave */
+		for (i = 0; i < ARRAY_SIZE(dev->regcache); i++)
+			if (dev->regcache[i].addr == addr)
+				dev->regcache[i].valid = false;
+		return;
 	}
 
-	return (x);
+	for (i = 0; i < len; i++) {
+		e = cxd2878_regcache_slot(dev, addr, bank, reg + i);
+		if (e->valid && e->addr == addr && e->bank == bank &&
+		    e->reg == reg + i)
+			e->val = buf[i];
+	}
 }
-static u32 sony_math_log10(u32 x)
+/*write failed, the bank of the slave is unknown now*/
+static void cxd2878_regcache_error(struct cxd2878_dev *dev, u8 addr)
 {
-	/* log10(x) = log2 (x) / log2 (10) */
-	/* Note uses: logN (x) = logM (x) / logM (N) */
-	return ((100 * sony_math_log2(x) + LOG2_10_100X / 2) / LOG2_10_100X);
+	s16 *slot = cxd2878_bank_slot(dev, addr);
+
+	if (slot)
+		*slot = -1;
 }
-static s32 sony_Convert2SComplement(u32 value, u32 bitlen)
+
+/*
+ * Register write batching: between cxd2878_batch_begin() and
+ * cxd2878_batch_commit() writes are only queued and then sent to the
+ * adapter as a single i2c_transfer, which runs them back to back under
+ * one bus lock and stops at the first nack. Reads flush the queue
+ * first so they see every write issued before them, and callers must
+ * flush before sleeping on a register write taking effect.
+ */
+static int cxd2878_batch_flush(struct cxd2878_dev *dev)
 {
-	if ((bitlen == 0) || (bitlen >= 32)) {
-		return (s32)value;
-	}
+	int ret;
 
-	if (value & (u32)(1 << (bitlen - 1))) {
-		/* minus value */
-		return (s32)(MASKUPPER(32 - bitlen) | value);
+	if (!dev->batch_nmsg)
+		return 0;
+
+	ret = i2c_transfer(dev->base->i2c, dev->batch_msg, dev->batch_nmsg);
+	if (ret != dev->batch_nmsg) {
+		if (ret >= 0)
+			ret = -EIO;
+		dev_warn(&dev->base->i2c->dev,
+			 "%s: i2c batch err(%i) (%d msgs)\n",
+			 KBUILD_MODNAME, ret, dev->batch_nmsg);
+		if (!dev->batch_err)
+			dev->batch_err = ret;
+		/*
+		 * the batch stopped somewhere, the banks and every register
+		 * cached when its writes were queued are unknown
+		 */
+		cxd2878_regcache_invalidate(dev);
 	} else {
-		/* plus value */
-		return (s32)(MASKLOWER(bitlen) & value);
+		ret = 0;
 	}
+
+	dev->batch_nmsg = 0;
+	dev->batch_len = 0;
+	return ret;
+}
+static void cxd2878_batch_begin(struct cxd2878_dev *dev)
+{
+	if (!dev->batch_depth++)
+		dev->batch_err = 0;
+}
+/*send the queued writes, returns the first error of the whole batch*/
+static int cxd2878_batch_commit(struct cxd2878_dev *dev)
+{
+	if (--dev->batch_depth)
+		return 0;
+
+	cxd2878_batch_flush(dev);
+	return dev->batch_err;
 }
 /*write multi registers*/
 static int cxd2878_wrm(struct cxd2878_dev *dev, u8 addr, u8 reg, u8 *buf,
@@ -145,6 +364,35 @@ static int cxd2878_wrm(struct cxd2878_dev *dev, u8 addr, u8 reg, u8 *buf,
 {
 	int ret;
 	u8 b0[50];
+	s16 *slot = cxd2878_bank_slot(dev, addr);
+
+	/* bank already selected */
+	if (slot && reg == 0x00 && len == 1 && *slot == buf[0])
+		return 0;
+
+	if (dev->batch_depth) {
+		struct i2c_msg *m;
+		u8 *b;
+
+		if (dev->batch_nmsg == CXD2878_BATCH_MSGS ||
+		    dev->batch_len + len + 1 > CXD2878_BATCH_BUF) {
+			ret = cxd2878_batch_flush(dev);
+			if (ret)
+				return ret;
+		}
+		b = &dev->batch_buf[dev->batch_len];
+		b[0] = reg;
+		memcpy(&b[1], buf, len);
+		m = &dev->batch_msg[dev->batch_nmsg++];
+		m->addr = addr;
+		m->flags = 0;
+		m->buf = b;
+		m->len = len + 1;
+		dev->batch_len += len + 1;
+		cxd2878_regcache_write(dev, addr, reg, buf, len);
+		return 0;
+	}
+
 	b0[0] = reg;
 	memcpy(&b0[1], buf, len);
 	struct i2c_msg msg = {
@@ -158,8 +406,10 @@ static int cxd2878_wrm(struct cxd2878_dev *dev, u8 addr, u8 reg, u8 *buf,
 		dev_warn(&dev->base->i2c->dev,
 			 "%s: i2c wrm err(%i) @0x%02x (len=%d)\n",
 			 KBUILD_MODNAME, ret, reg, len);
+		cxd2878_regcache_error(dev, addr);
 		return ret;
 	}
+	cxd2878_regcache_write(dev, addr, reg, buf, len);
 
 	//printk("wrm : addr = 0x%x args=%*ph\n",addr*2,len+1,b0);
 	return 0;
@@ -179,6 +429,12 @@ static int cxd2878_rdm(struct cxd2878_dev *dev, u8 addr, u8 reg, u8 *buf,
 		{ .addr = addr, .flags = I2C_M_RD, .buf = buf, .len = len }
 	};
 
+	if (dev->batch_depth) {
+		ret = cxd2878_batch_flush(dev);
+		if (ret)
+			return ret;
+	}
+
 	ret = i2c_transfer(dev->base->i2c, msg, 2);
 	if (ret < 0) {
 		dev_warn(&dev->base->i2c->dev,
@@ -191,6 +447,33 @@ static int cxd2878_rdm(struct cxd2878_dev *dev, u8 addr, u8 reg, u8 *buf,
 
 	return 0;
 }
+/*read one configuration register, from the cache if possible*/
+static int cxd2878_rdc(struct cxd2878_dev *dev, u8 addr, u8 reg, u8 *val)
+{
+	struct cxd2878_regcache_entry *e;
+	int bank = cxd2878_cur_bank(dev, addr);
+	int ret;
+
+	if (bank < 0 || cxd2878_reg_volatile(dev, addr, bank, reg))
+		return cxd2878_rdm(dev, addr, reg, val, 1);
+
+	e = cxd2878_regcache_slot(dev, addr, bank, reg);
+	if (e->valid && e->addr == addr && e->bank == bank && e->reg == reg) {
+		*val = e->val;
+		return 0;
+	}
+
+	ret = cxd2878_rdm(dev, addr, reg, val, 1);
+	if (ret)
+		return ret;
+
+	e->addr = addr;
+	e->bank = bank;
+	e->reg = reg;
+	e->val = *val;
+	e->valid = true;
+	return 0;
+}
 static int cxd2878_SetRegisterBits(struct cxd2878_dev *dev, u8 slaveaddress,
 				   u8 registerAddr, u8 data, u8 mask)
 {
@@ -201,7 +484,7 @@ static int cxd2878_SetRegisterBits(struct cxd2878_dev *dev, u8 slaveaddress,
 		return 0;
 
 	if (mask != 0xFF) {
-		ret = cxd2878_rdm(dev, slaveaddress, registerAddr, &rdata, 1);
+		ret = cxd2878_rdc(dev, slaveaddress, registerAddr, &rdata);
 		if (ret)
 			return ret;
 		data = ((data & mask) | (rdata & (mask ^ 0xFF)));
@@ -240,15 +523,33 @@ err:
 	return ret;
 }
 
+/*
+ * Demods sharing a base sit on the same bus, only one of them may have
+ * its repeater open or tuner traffic would reach both tuners. A held
+ * open repeater of the other demod is closed first.
+ */
 static int cxd2878_i2c_repeater(struct cxd2878_dev *dev, bool enable)
 {
+	struct cxd2878_dev *other = dev->base->gate_dev;
 	int ret;
 
+	if (enable && other && other != dev) {
+		ret = cxd2878_i2c_repeater(other, 0);
+		if (ret)
+			return ret;
+	}
+
 	ret = cxd2878_wr(dev, dev->slvx, 0x08, enable ? 1 : 0);
+	if (!ret)
+		ret = cxd2878_batch_flush(dev);
 	if (ret)
 		goto err;
 
-	msleep(20);
+	dev->gate_open = enable;
+	if (enable)
+		dev->base->gate_dev = dev;
+	else if (dev->base->gate_dev == dev)
+		dev->base->gate_dev = NULL;
 
 	return 0;
 
@@ -258,6 +559,58 @@ err:
 	return ret;
 }
 
+/*
+ * Tuner accesses are bracketed by cxd2878_gate_get()/cxd2878_gate_put(),
+ * called with i2c_lock held. The repeater is only written and the settle
+ * delay only taken when it is actually closed; after the last user it
+ * stays open for gate_hold_ms so back to back tuner accesses share one
+ * window.
+ */
+static int cxd2878_gate_get(struct cxd2878_dev *dev)
+{
+	int ret;
+
+	if (dev->gate_users++)
+		return 0;
+
+	cancel_delayed_work(&dev->gate_work);
+	if (dev->gate_open)
+		return 0;
+
+	ret = cxd2878_i2c_repeater(dev, 1);
+	if (ret)
+		return ret;
+
+	if (gate_settle_ms)
+		msleep(gate_settle_ms);
+
+	return 0;
+}
+
+static void cxd2878_gate_put(struct cxd2878_dev *dev)
+{
+	if (--dev->gate_users)
+		return;
+
+	if (gate_hold_ms)
+		mod_delayed_work(system_power_efficient_wq, &dev->gate_work,
+				 msecs_to_jiffies(gate_hold_ms));
+	else
+		cxd2878_i2c_repeater(dev, 0);
+}
+
+static void cxd2878_gate_work(struct work_struct *work)
+{
+	struct cxd2878_dev *dev =
+		container_of(to_delayed_work(work), struct cxd2878_dev,
+			     gate_work);
+
+	mutex_lock(&dev->base->i2c_lock);
+	if (!dev->gate_users && dev->gate_open)
+		cxd2878_i2c_repeater(dev, 0);
+	mutex_unlock(&dev->base->i2c_lock);
+}
+
 static int cxd2857_read_rssi_isdbt(struct cxd2878_dev *dev, u32 frequency,
 				   s32 *rssi)
 {
@@ -268,7 +621,7 @@ static int cxd2857_read_rssi_isdbt(struct cxd2878_dev *dev, u32 frequency,
 	s32 if_bpf_gc_table[] = { -6, -4, -2, 0,  2,  4,  6,  8,
 				  10, 12, 14, 16, 18, 20, 20, 20 };
 	s32 if_bpf_gc_x100 = 0;
-	s32 agcreg_x140 = 0, maxagcreg_x140 = 0, rfgainmax_100 = 0;
+	s32 agcreg_x140 = 0, maxagcreg_x140 = 0;
 
 	data[0] = 0xc4;
 	data[1] = 0x41; //(x87 x88)
@@ -328,88 +681,7 @@ static int cxd2857_read_rssi_isdbt(struct cxd2878_dev *dev, u32 frequency,
 	else
 		maxagcreg_x140 = rfagc * 140;
 
-	if (frequency < 55000)
-		rfgainmax_100 = 4690;
-	else if (frequency < 65000)
-		rfgainmax_100 = 4800;
-	else if (frequency < 86000)
-		rfgainmax_100 = 4920;
-	else if (frequency < 125000)
-		rfgainmax_100 = 4960;
-	else if (frequency < 142000)
-		rfgainmax_100 = 4890;
-	else if (frequency < 165000)
-		rfgainmax_100 = 4770;
-	else if (frequency < 172000)
-		rfgainmax_100 = 4610;
-	else if (frequency < 200000)
-		rfgainmax_100 = 4580;
-	else if (frequency < 225000)
-		rfgainmax_100 = 4680;
-	else if (frequency < 250000)
-		rfgainmax_100 = 4770;
-	else if (frequency < 320000)
-		rfgainmax_100 = 4840;
-	else if (frequency < 350000)
-		rfgainmax_100 = 4740;
-	else if (frequency < 400000)
-		rfgainmax_100 = 4750;
-	else if (frequency < 464000)
-		rfgainmax_100 = 4750;
-	else if (frequency < 532000)
-		rfgainmax_100 = 4450;
-	else if (frequency < 600000)
-		rfgainmax_100 = 4530;
-	else if (frequency < 664000)
-		rfgainmax_100 = 4580;
-	else if (frequency < 766000)
-		rfgainmax_100 = 4630;
-	else if (frequency < 868000)
-		rfgainmax_100 = 4630;
-	else if (frequency < 900000)
-		rfgainmax_100 = 4600;
-	else if (frequency < 950000)
-		rfgainmax_100 = 4480;
-	else
-		rfgainmax_100 = 4300;
-
-	if (maxagcreg_x140 < 3825)
-		rfgain = rfgainmax_100;
-	else if (maxagcreg_x140 < 6375)
-		rfgain = rfgainmax_100 -
-			 ((maxagcreg_x140 - 3825) * 160 + 12750) / 25500;
-	else if (maxagcreg_x140 < 7650)
-		rfgain = (rfgainmax_100 - 16) -
-			 ((maxagcreg_x140 - 6375) * 1340 + 12750) / 25500;
-	else if (maxagcreg_x140 < 8925)
-		rfgain = (rfgainmax_100 - 83) -
-			 ((maxagcreg_x140 - 7650) * 3440 + 12750) / 25500;
-	else if (maxagcreg_x140 < 10200)
-		rfgain = (rfgainmax_100 - 258) -
-			 ((maxagcreg_x140 - 8925) * 5421 + 12750) / 25500;
-	else if (maxagcreg_x140 < 11475)
-		rfgain = (rfgainmax_100 - 529) -
-			 ((maxagcreg_x140 - 10200) * 7451 + 12750) / 25500;
-	else if (maxagcreg_x140 < 15300)
-		rfgain = (rfgainmax_100 - 902) -
-			 ((maxagcreg_x140 - 11475) * 8253 + 12750) / 25500;
-	else if (maxagcreg_x140 < 19125)
-		rfgain = (rfgainmax_100 - 2139) -
-			 ((maxagcreg_x140 - 15300) * 6979 + 12750) / 25500;
-	else if (maxagcreg_x140 < 24225)
-		rfgain = (rfgainmax_100 - 3186) -
-			 ((maxagcreg_x140 - 19125) * 7468 + 12750) / 25500;
-	else if (maxagcreg_x140 < 26775)
-		rfgain = (rfgainmax_100 - 4680) -
-			 ((maxagcreg_x140 - 24225) * 5674 + 12750) / 25500;
-	else if (maxagcreg_x140 < 29325)
-		rfgain = (rfgainmax_100 - 5247) -
-			 ((maxagcreg_x140 - 26775) * 14592 + 12750) / 25500;
-	else if (maxagcreg_x140 < 31875)
-		rfgain = (rfgainmax_100 - 6717) -
-			 ((maxagcreg_x140 - 29325) * 16676 + 12750) / 25500;
-	else
-		rfgain = rfgainmax_100 - 8384;
+	rfgain = cxd2857_rfgain_isdbt(frequency, maxagcreg_x140);
 
 	*rssi = -ifgain - rfgain - (sony_Convert2SComplement(d, 4) * 100);
 	return 0;
@@ -458,201 +730,11 @@ err:
 	return ret;
 }
 
-struct cn_data_entry {
-	uint32_t value;
-	int32_t cnr;
-};
-
-static const struct cn_data_entry isdbs3_cn_table[] = {
-	{ 0x10da5, -4000 }, { 0x107dd, -3900 }, { 0x1023c, -3800 },
-	{ 0x0fcc1, -3700 }, { 0x0f76b, -3600 }, { 0x0f237, -3500 },
-	{ 0x0ed25, -3400 }, { 0x0e834, -3300 }, { 0x0e361, -3200 },
-	{ 0x0deab, -3100 }, { 0x0da13, -3000 }, { 0x0d596, -2900 },
-	{ 0x0d133, -2800 }, { 0x0cceb, -2700 }, { 0x0c8bb, -2600 },
-	{ 0x0c4a4, -2500 }, { 0x0c0a3, -2400 }, { 0x0bcba, -2300 },
-	{ 0x0b8e6, -2200 }, { 0x0b527, -2100 }, { 0x0b17d, -2000 },
-	{ 0x0ade6, -1900 }, { 0x0aa63, -1800 }, { 0x0a6f3, -1700 },
-	{ 0x0a395, -1600 }, { 0x0a049, -1500 }, { 0x09d0e, -1400 },
-	{ 0x099e4, -1300 }, { 0x096cb, -1200 }, { 0x093c1, -1100 },
-	{ 0x090c7, -1000 }, { 0x08ddc, -900 },	{ 0x08b00, -800 },
-	{ 0x08833, -700 },  { 0x08573, -600 },	{ 0x082c2, -500 },
-	{ 0x0801e, -400 },  { 0x07d87, -300 },	{ 0x07afd, -200 },
-	{ 0x0787f, -100 },  { 0x0760c, 0 },	{ 0x073a9, 100 },
-	{ 0x0714f, 200 },   { 0x06f02, 300 },	{ 0x06cbf, 400 },
-	{ 0x06a88, 500 },   { 0x0685b, 600 },	{ 0x06639, 700 },
-	{ 0x06421, 800 },   { 0x06214, 900 },	{ 0x06010, 1000 },
-	{ 0x05e16, 1100 },  { 0x05c26, 1200 },	{ 0x05a40, 1300 },
-	{ 0x05862, 1400 },  { 0x0568e, 1500 },	{ 0x054c2, 1600 },
-	{ 0x05300, 1700 },  { 0x05146, 1800 },	{ 0x04f94, 1900 },
-	{ 0x04deb, 2000 },  { 0x04c49, 2100 },	{ 0x04ab0, 2200 },
-	{ 0x0491f, 2300 },  { 0x04795, 2400 },	{ 0x04613, 2500 },
-	{ 0x04498, 2600 },  { 0x04325, 2700 },	{ 0x041b8, 2800 },
-	{ 0x04053, 2900 },  { 0x03ef5, 3000 },	{ 0x03d9e, 3100 },
-	{ 0x03c4d, 3200 },  { 0x03b02, 3300 },	{ 0x039bf, 3400 },
-	{ 0x03881, 3500 },  { 0x0374a, 3600 },	{ 0x03619, 3700 },
-	{ 0x034ee, 3800 },  { 0x033c9, 3900 },	{ 0x032aa, 4000 },
-	{ 0x03191, 4100 },  { 0x0307d, 4200 },	{ 0x02f6f, 4300 },
-	{ 0x02e66, 4400 },  { 0x02d62, 4500 },	{ 0x02c64, 4600 },
-	{ 0x02b6b, 4700 },  { 0x02a77, 4800 },	{ 0x02988, 4900 },
-	{ 0x0289e, 5000 },  { 0x027b9, 5100 },	{ 0x026d9, 5200 },
-	{ 0x025fd, 5300 },  { 0x02526, 5400 },	{ 0x02453, 5500 },
-	{ 0x02385, 5600 },  { 0x022bb, 5700 },	{ 0x021f5, 5800 },
-	{ 0x02134, 5900 },  { 0x02076, 6000 },	{ 0x01fbd, 6100 },
-	{ 0x01f08, 6200 },  { 0x01e56, 6300 },	{ 0x01da9, 6400 },
-	{ 0x01cff, 6500 },  { 0x01c58, 6600 },	{ 0x01bb5, 6700 },
-	{ 0x01b16, 6800 },  { 0x01a7b, 6900 },	{ 0x019e2, 7000 },
-	{ 0x0194d, 7100 },  { 0x018bc, 7200 },	{ 0x0182d, 7300 },
-	{ 0x017a2, 7400 },  { 0x0171a, 7500 },	{ 0x01695, 7600 },
-	{ 0x01612, 7700 },  { 0x01593, 7800 },	{ 0x01517, 7900 },
-	{ 0x0149d, 8000 },  { 0x01426, 8100 },	{ 0x013b2, 8200 },
-	{ 0x01340, 8300 },  { 0x012d1, 8400 },	{ 0x01264, 8500 },
-	{ 0x011fa, 8600 },  { 0x01193, 8700 },	{ 0x0112d, 8800 },
-	{ 0x010ca, 8900 },  { 0x01069, 9000 },	{ 0x0100b, 9100 },
-	{ 0x00fae, 9200 },  { 0x00f54, 9300 },	{ 0x00efb, 9400 },
-	{ 0x00ea5, 9500 },  { 0x00e51, 9600 },	{ 0x00dff, 9700 },
-	{ 0x00dae, 9800 },  { 0x00d60, 9900 },	{ 0x00d13, 10000 },
-	{ 0x00cc8, 10100 }, { 0x00c7e, 10200 }, { 0x00c37, 10300 },
-	{ 0x00bf1, 10400 }, { 0x00bac, 10500 }, { 0x00b6a, 10600 },
-	{ 0x00b28, 10700 }, { 0x00ae8, 10800 }, { 0x00aaa, 10900 },
-	{ 0x00a6d, 11000 }, { 0x00a32, 11100 }, { 0x009f8, 11200 },
-	{ 0x009bf, 11300 }, { 0x00987, 11400 }, { 0x00951, 11500 },
-	{ 0x0091c, 11600 }, { 0x008e8, 11700 }, { 0x008b6, 11800 },
-	{ 0x00884, 11900 }, { 0x00854, 12000 }, { 0x00825, 12100 },
-	{ 0x007f7, 12200 }, { 0x007ca, 12300 }, { 0x0079e, 12400 },
-	{ 0x00773, 12500 }, { 0x00749, 12600 }, { 0x00720, 12700 },
-	{ 0x006f8, 12800 }, { 0x006d0, 12900 }, { 0x006aa, 13000 },
-	{ 0x00685, 13100 }, { 0x00660, 13200 }, { 0x0063c, 13300 },
-	{ 0x00619, 13400 }, { 0x005f7, 13500 }, { 0x005d6, 13600 },
-	{ 0x005b5, 13700 }, { 0x00595, 13800 }, { 0x00576, 13900 },
-	{ 0x00558, 14000 }, { 0x0053a, 14100 }, { 0x0051d, 14200 },
-	{ 0x00501, 14300 }, { 0x004e5, 14400 }, { 0x004c9, 14500 },
-	{ 0x004af, 14600 }, { 0x00495, 14700 }, { 0x0047b, 14800 },
-	{ 0x00462, 14900 }, { 0x0044a, 15000 }, { 0x00432, 15100 },
-	{ 0x0041b, 15200 }, { 0x00404, 15300 }, { 0x003ee, 15400 },
-	{ 0x003d8, 15500 }, { 0x003c3, 15600 }, { 0x003ae, 15700 },
-	{ 0x0039a, 15800 }, { 0x00386, 15900 }, { 0x00373, 16000 },
-	{ 0x00360, 16100 }, { 0x0034d, 16200 }, { 0x0033b, 16300 },
-	{ 0x00329, 16400 }, { 0x00318, 16500 }, { 0x00307, 16600 },
-	{ 0x002f6, 16700 }, { 0x002e6, 16800 }, { 0x002d6, 16900 },
-	{ 0x002c7, 17000 }, { 0x002b7, 17100 }, { 0x002a9, 17200 },
-	{ 0x0029a, 17300 }, { 0x0028c, 17400 }, { 0x0027e, 17500 },
-	{ 0x00270, 17600 }, { 0x00263, 17700 }, { 0x00256, 17800 },
-	{ 0x00249, 17900 }, { 0x0023d, 18000 }, { 0x00231, 18100 },
-	{ 0x00225, 18200 }, { 0x00219, 18300 }, { 0x0020e, 18400 },
-	{ 0x00203, 18500 }, { 0x001f8, 18600 }, { 0x001ed, 18700 },
-	{ 0x001e3, 18800 }, { 0x001d9, 18900 }, { 0x001cf, 19000 },
-	{ 0x001c5, 19100 }, { 0x001bc, 19200 }, { 0x001b2, 19300 },
-	{ 0x001a9, 19400 }, { 0x001a0, 19500 }, { 0x00198, 19600 },
-	{ 0x0018f, 19700 }, { 0x00187, 19800 }, { 0x0017f, 19900 },
-	{ 0x00177, 20000 }, { 0x0016f, 20100 }, { 0x00168, 20200 },
-	{ 0x00160, 20300 }, { 0x00159, 20400 }, { 0x00152, 20500 },
-	{ 0x0014b, 20600 }, { 0x00144, 20700 }, { 0x0013e, 20800 },
-	{ 0x00137, 20900 }, { 0x00131, 21000 }, { 0x0012b, 21100 },
-	{ 0x00125, 21200 }, { 0x0011f, 21300 }, { 0x00119, 21400 },
-	{ 0x00113, 21500 }, { 0x0010e, 21600 }, { 0x00108, 21700 },
-	{ 0x00103, 21800 }, { 0x000fe, 21900 }, { 0x000f9, 22000 },
-	{ 0x000f4, 22100 }, { 0x000ef, 22200 }, { 0x000eb, 22300 },
-	{ 0x000e6, 22400 }, { 0x000e2, 22500 }, { 0x000de, 22600 },
-	{ 0x000da, 22700 }, { 0x000d5, 22800 }, { 0x000d1, 22900 },
-	{ 0x000cd, 23000 }, { 0x000ca, 23100 }, { 0x000c6, 23200 },
-	{ 0x000c2, 23300 }, { 0x000be, 23400 }, { 0x000bb, 23500 },
-	{ 0x000b7, 23600 }, { 0x000b4, 23700 }, { 0x000b1, 23800 },
-	{ 0x000ae, 23900 }, { 0x000aa, 24000 }, { 0x000a7, 24100 },
-	{ 0x000a4, 24200 }, { 0x000a2, 24300 }, { 0x0009f, 24400 },
-	{ 0x0009c, 24500 }, { 0x00099, 24600 }, { 0x00097, 24700 },
-	{ 0x00094, 24800 }, { 0x00092, 24900 }, { 0x0008f, 25000 },
-	{ 0x0008d, 25100 }, { 0x0008b, 25200 }, { 0x00088, 25300 },
-	{ 0x00086, 25400 }, { 0x00084, 25500 }, { 0x00082, 25600 },
-	{ 0x00080, 25700 }, { 0x0007e, 25800 }, { 0x0007c, 25900 },
-	{ 0x0007a, 26000 }, { 0x00078, 26100 }, { 0x00076, 26200 },
-	{ 0x00074, 26300 }, { 0x00073, 26400 }, { 0x00071, 26500 },
-	{ 0x0006f, 26600 }, { 0x0006d, 26700 }, { 0x0006c, 26800 },
-	{ 0x0006a, 26900 }, { 0x00069, 27000 }, { 0x00067, 27100 },
-	{ 0x00066, 27200 }, { 0x00064, 27300 }, { 0x00063, 27400 },
-	{ 0x00061, 27500 }, { 0x00060, 27600 }, { 0x0005f, 27700 },
-	{ 0x0005d, 27800 }, { 0x0005c, 27900 }, { 0x0005b, 28000 },
-	{ 0x0005a, 28100 }, { 0x00059, 28200 }, { 0x00057, 28300 },
-	{ 0x00056, 28400 }, { 0x00055, 28500 }, { 0x00054, 28600 },
-	{ 0x00053, 28700 }, { 0x00052, 28800 }, { 0x00051, 28900 },
-	{ 0x00050, 29000 }, { 0x0004f, 29100 }, { 0x0004e, 29200 },
-	{ 0x0004d, 29300 }, { 0x0004c, 29400 }, { 0x0004b, 29500 },
-	{ 0x0004a, 29600 }, { 0x00049, 29700 }, { 0x00048, 29900 },
-	{ 0x00047, 30000 },
-};
-
-static const struct cn_data_entry isdbs_cn_table[] = {
-	{ 0x05af, 0 },	   { 0x0597, 100 },   { 0x057e, 200 },
-	{ 0x0567, 300 },   { 0x0550, 400 },   { 0x0539, 500 },
-	{ 0x0522, 600 },   { 0x050c, 700 },   { 0x04f6, 800 },
-	{ 0x04e1, 900 },   { 0x04cc, 1000 },  { 0x04b6, 1100 },
-	{ 0x04a1, 1200 },  { 0x048c, 1300 },  { 0x0477, 1400 },
-	{ 0x0463, 1500 },  { 0x044f, 1600 },  { 0x043c, 1700 },
-	{ 0x0428, 1800 },  { 0x0416, 1900 },  { 0x0403, 2000 },
-	{ 0x03ef, 2100 },  { 0x03dc, 2200 },  { 0x03c9, 2300 },
-	{ 0x03b6, 2400 },  { 0x03a4, 2500 },  { 0x0392, 2600 },
-	{ 0x0381, 2700 },  { 0x036f, 2800 },  { 0x035f, 2900 },
-	{ 0x034e, 3000 },  { 0x033d, 3100 },  { 0x032d, 3200 },
-	{ 0x031d, 3300 },  { 0x030d, 3400 },  { 0x02fd, 3500 },
-	{ 0x02ee, 3600 },  { 0x02df, 3700 },  { 0x02d0, 3800 },
-	{ 0x02c2, 3900 },  { 0x02b4, 4000 },  { 0x02a6, 4100 },
-	{ 0x0299, 4200 },  { 0x028c, 4300 },  { 0x027f, 4400 },
-	{ 0x0272, 4500 },  { 0x0265, 4600 },  { 0x0259, 4700 },
-	{ 0x024d, 4800 },  { 0x0241, 4900 },  { 0x0236, 5000 },
-	{ 0x022b, 5100 },  { 0x0220, 5200 },  { 0x0215, 5300 },
-	{ 0x020a, 5400 },  { 0x0200, 5500 },  { 0x01f6, 5600 },
-	{ 0x01ec, 5700 },  { 0x01e2, 5800 },  { 0x01d8, 5900 },
-	{ 0x01cf, 6000 },  { 0x01c6, 6100 },  { 0x01bc, 6200 },
-	{ 0x01b3, 6300 },  { 0x01aa, 6400 },  { 0x01a2, 6500 },
-	{ 0x0199, 6600 },  { 0x0191, 6700 },  { 0x0189, 6800 },
-	{ 0x0181, 6900 },  { 0x0179, 7000 },  { 0x0171, 7100 },
-	{ 0x0169, 7200 },  { 0x0161, 7300 },  { 0x015a, 7400 },
-	{ 0x0153, 7500 },  { 0x014b, 7600 },  { 0x0144, 7700 },
-	{ 0x013d, 7800 },  { 0x0137, 7900 },  { 0x0130, 8000 },
-	{ 0x012a, 8100 },  { 0x0124, 8200 },  { 0x011e, 8300 },
-	{ 0x0118, 8400 },  { 0x0112, 8500 },  { 0x010c, 8600 },
-	{ 0x0107, 8700 },  { 0x0101, 8800 },  { 0x00fc, 8900 },
-	{ 0x00f7, 9000 },  { 0x00f2, 9100 },  { 0x00ec, 9200 },
-	{ 0x00e7, 9300 },  { 0x00e2, 9400 },  { 0x00dd, 9500 },
-	{ 0x00d8, 9600 },  { 0x00d4, 9700 },  { 0x00cf, 9800 },
-	{ 0x00ca, 9900 },  { 0x00c6, 10000 }, { 0x00c2, 10100 },
-	{ 0x00be, 10200 }, { 0x00b9, 10300 }, { 0x00b5, 10400 },
-	{ 0x00b1, 10500 }, { 0x00ae, 10600 }, { 0x00aa, 10700 },
-	{ 0x00a6, 10800 }, { 0x00a3, 10900 }, { 0x009f, 11000 },
-	{ 0x009b, 11100 }, { 0x0098, 11200 }, { 0x0095, 11300 },
-	{ 0x0091, 11400 }, { 0x008e, 11500 }, { 0x008b, 11600 },
-	{ 0x0088, 11700 }, { 0x0085, 11800 }, { 0x0082, 11900 },
-	{ 0x007f, 12000 }, { 0x007c, 12100 }, { 0x007a, 12200 },
-	{ 0x0077, 12300 }, { 0x0074, 12400 }, { 0x0072, 12500 },
-	{ 0x006f, 12600 }, { 0x006d, 12700 }, { 0x006b, 12800 },
-	{ 0x0068, 12900 }, { 0x0066, 13000 }, { 0x0064, 13100 },
-	{ 0x0061, 13200 }, { 0x005f, 13300 }, { 0x005d, 13400 },
-	{ 0x005b, 13500 }, { 0x0059, 13600 }, { 0x0057, 13700 },
-	{ 0x0055, 13800 }, { 0x0053, 13900 }, { 0x0051, 14000 },
-	{ 0x004f, 14100 }, { 0x004e, 14200 }, { 0x004c, 14300 },
-	{ 0x004a, 14400 }, { 0x0049, 14500 }, { 0x0047, 14600 },
-	{ 0x0045, 14700 }, { 0x0044, 14800 }, { 0x0042, 14900 },
-	{ 0x0041, 15000 }, { 0x003f, 15100 }, { 0x003e, 15200 },
-	{ 0x003c, 15300 }, { 0x003b, 15400 }, { 0x003a, 15500 },
-	{ 0x0038, 15600 }, { 0x0037, 15700 }, { 0x0036, 15800 },
-	{ 0x0034, 15900 }, { 0x0033, 16000 }, { 0x0032, 16100 },
-	{ 0x0031, 16200 }, { 0x0030, 16300 }, { 0x002f, 16400 },
-	{ 0x002e, 16500 }, { 0x002d, 16600 }, { 0x002c, 16700 },
-	{ 0x002b, 16800 }, { 0x002a, 16900 }, { 0x0029, 17000 },
-	{ 0x0028, 17100 }, { 0x0027, 17200 }, { 0x0026, 17300 },
-	{ 0x0025, 17400 }, { 0x0024, 17500 }, { 0x0023, 17600 },
-	{ 0x0022, 17800 }, { 0x0021, 17900 }, { 0x0020, 18000 },
-	{ 0x001f, 18200 }, { 0x001e, 18300 }, { 0x001d, 18500 },
-	{ 0x001c, 18700 }, { 0x001b, 18900 }, { 0x001a, 19000 },
-	{ 0x0019, 19200 }, { 0x0018, 19300 }, { 0x0017, 19500 },
-	{ 0x0016, 19700 }, { 0x0015, 19900 }, { 0x0014, 20000 },
-};
-
 static int cxd2857_read_cnr_isdbs3(struct cxd2878_dev *dev, s64 *cnr)
 {
 	int ret;
 	u8 data[4];
 	u32 value;
-	size_t i;
 
 	ret = cxd2878_wr(dev, dev->slvt, 0x00, 0xd0);
 	if (ret)
@@ -664,13 +746,7 @@ static int cxd2857_read_cnr_isdbs3(struct cxd2878_dev *dev, s64 *cnr)
 		return -EINVAL;
 	}
 	value = ((data[1] << 16) | (data[2] << 8) | data[3]) & 0x1ffff;
-	for (i = 1; i < sizeof(isdbs3_cn_table) / sizeof(isdbs3_cn_table[0]);
-	     i++) {
-		if (isdbs3_cn_table[i].value < value) {
-			break;
-		}
-	}
-	*cnr = isdbs3_cn_table[i - 1].cnr;
+	*cnr = cxd2857_cnr_isdbs3(value);
 	return 0;
 
 err:
@@ -684,7 +760,6 @@ static int cxd2857_read_cnr_isdbs(struct cxd2878_dev *dev, s64 *cnr)
 	int ret;
 	u8 data[4];
 	u32 value;
-	size_t i;
 
 	ret = cxd2878_wr(dev, dev->slvt, 0x00, 0xa1);
 	if (ret)
@@ -696,13 +771,7 @@ static int cxd2857_read_cnr_isdbs(struct cxd2878_dev *dev, s64 *cnr)
 		return -EINVAL;
 	}
 	value = ((data[1] << 8) | data[2]) & 0x1fff;
-	for (i = 1; i < sizeof(isdbs_cn_table) / sizeof(isdbs_cn_table[0]);
-	     i++) {
-		if (isdbs_cn_table[i].value < value) {
-			break;
-		}
-	}
-	*cnr = isdbs_cn_table[i - 1].cnr;
+	*cnr = cxd2857_cnr_isdbs(value);
 	return 0;
 
 err:
@@ -750,6 +819,8 @@ static int cxd2857_tune(struct cxd2878_dev *dev, u32 frequencykHz)
 		goto err;
 	}
 
+	cxd2878_batch_begin(dev);
+
 	if (dev->tuner_state == SONY_TUNER_STATE_T &&
 	    tuner_state == SONY_TUNER_STATE_S) {
 		u8 data[] = { 0x15, 0x00, 0x00 };
@@ -759,20 +830,24 @@ static int cxd2857_tune(struct cxd2878_dev *dev, u32 frequencykHz)
 		cxd2878_wr(dev, dev->tuner_addr, 0x88, 0x00);
 		cxd2878_wr(dev, dev->tuner_addr, 0x87, 0xc0);
 	}
+	/* the common satellite setting is kept between S and S3 tunes */
+	bool sat_ready = dev->tuner_state == SONY_TUNER_STATE_S;
 	dev->tuner_state = tuner_state;
 	if (tuner_state == SONY_TUNER_STATE_S) {
-		ret = cxd2878_wr(dev, dev->tuner_addr, 0x15, 0x12);
-		if (ret)
-			goto err;
-		u8 data[] = { 0x00, 0x00 };
-		cxd2878_wrm(dev, dev->tuner_addr, 0x6a, data, 2);
-		u8 if_out_sel[] = { 0x12, 0xf9, 0x0f, 0x25, 0x44 };
-		cxd2878_wrm(dev, dev->tuner_addr, 0x74, if_out_sel, 5);
-		cxd2878_wr(dev, dev->tuner_addr, 0x75, 0xf9);
-		cxd2878_wr(dev, dev->tuner_addr, 0x40, 0x07);
-		cxd2878_wr(dev, dev->tuner_addr, 0x41, 0x07);
-		cxd2878_wr(dev, dev->tuner_addr, 0x45, 0x03);
-		cxd2878_wr(dev, dev->tuner_addr, 0x48, 0x07);
+		if (!sat_ready) {
+			ret = cxd2878_wr(dev, dev->tuner_addr, 0x15, 0x12);
+			if (ret)
+				goto err_batch;
+			u8 data[] = { 0x00, 0x00 };
+			cxd2878_wrm(dev, dev->tuner_addr, 0x6a, data, 2);
+			u8 if_out_sel[] = { 0x12, 0xf9, 0x0f, 0x25, 0x44 };
+			cxd2878_wrm(dev, dev->tuner_addr, 0x74, if_out_sel, 5);
+			cxd2878_wr(dev, dev->tuner_addr, 0x75, 0xf9);
+			cxd2878_wr(dev, dev->tuner_addr, 0x40, 0x07);
+			cxd2878_wr(dev, dev->tuner_addr, 0x41, 0x07);
+			cxd2878_wr(dev, dev->tuner_addr, 0x45, 0x03);
+			cxd2878_wr(dev, dev->tuner_addr, 0x48, 0x07);
+		}
 		u8 data0x04[8] = { 0xc4, 0x40 };
 		data0x04[2] = dev->base->config.tuner_xtal ==
 					      SONY_ASCOT3_XTAL_24000KHz ?
@@ -805,6 +880,9 @@ static int cxd2857_tune(struct cxd2878_dev *dev, u32 frequencykHz)
 			data0x0c[6] = (u8)((f >> 16) & 0xF);
 			cxd2878_wrm(dev, dev->tuner_addr, 0x0c, data0x0c, 10);
 		} else {
+			/* a previous left-hand tune changed it */
+			if (sat_ready)
+				cxd2878_wr(dev, dev->tuner_addr, 0x45, 0x03);
 			cxd2878_wr(dev, dev->tuner_addr, 0x43, 0x04);
 			cxd2878_wr(dev, dev->tuner_addr, 0x01, 0x01);
 			u8 data0x0c[10] = { 0xfe, 0x22, 0x9e, 0x16, 0x00,
@@ -814,13 +892,14 @@ static int cxd2857_tune(struct cxd2878_dev *dev, u32 frequencykHz)
 			data0x0c[6] = (u8)((f >> 16) & 0xF);
 			cxd2878_wrm(dev, dev->tuner_addr, 0x0c, data0x0c, 10);
 		}
+		cxd2878_batch_flush(dev);
 		msleep(10);
 		cxd2878_wr(dev, dev->tuner_addr, 0x05, 0x00);
 		cxd2878_wr(dev, dev->tuner_addr, 0x04, 0xc0);
 	} else {
 		ret = cxd2878_wr(dev, dev->tuner_addr, 0x01, 0x00);
 		if (ret)
-			goto err;
+			goto err_batch;
 
 		u8 if_out_sel[] = { 0x12, 0xf9, 0x0f, 0x05, 0x44 };
 		cxd2878_wrm(dev, dev->tuner_addr, 0x74, if_out_sel, 5);
@@ -846,7 +925,7 @@ static int cxd2857_tune(struct cxd2878_dev *dev, u32 frequencykHz)
 		ret = cxd2878_SetRegisterBits(dev, dev->tuner_addr, 0x67, 0x00,
 					      0x02);
 		if (ret)
-			goto err;
+			goto err_batch;
 		/*0x68~0x78*/
 		u8 tmp[17];
 		tmp[0] = 0x00;
@@ -909,16 +988,24 @@ static int cxd2857_tune(struct cxd2878_dev *dev, u32 frequencykHz)
 		tmp[11] = 0xFF;
 		tmp[12] = 0x11;
 		ret = cxd2878_wrm(dev, dev->tuner_addr, 0x68, tmp, 13);
+		if (!ret)
+			ret = cxd2878_batch_flush(dev);
 		if (ret)
-			goto err;
+			goto err_batch;
 
 		msleep(50);
 
 		cxd2878_wr(dev, dev->tuner_addr, 0x88, 0x00);
 		cxd2878_wr(dev, dev->tuner_addr, 0x87, 0xc0);
 	}
+
+	ret = cxd2878_batch_commit(dev);
+	if (ret)
+		goto err;
 	return 0;
 
+err_batch:
+	cxd2878_batch_commit(dev);
 err:
 	dev_err(&dev->base->i2c->dev, "%s: Tuner cxd2857 tuner error !",
 		KBUILD_MODNAME);
@@ -1007,6 +1094,7 @@ static int cxd2857_init(struct cxd2878_dev *dev)
 
 	cxd2878_wr(dev, dev->tuner_addr, 0x9b, 0x00);
 
+	cxd2878_batch_flush(dev);
 	msleep(10);
 	/* Check CPU_STT (0x1A) */
 	cxd2878_rdm(dev, dev->tuner_addr, 0x1A, &rdata, 1);
@@ -1044,7 +1132,7 @@ static int cxd2878_setstreamoutput(struct cxd2878_dev *dev, int enable)
 	if (cxd2878_wr(dev, dev->slvt, 0xfe, 0x01) != 0) {
 		goto err;
 	}
-	if (cxd2878_rdm(dev, dev->slvt, 0xA9, &data, 1) != 0) {
+	if (cxd2878_rdc(dev, dev->slvt, 0xA9, &data) != 0) {
 		goto err;
 	}
 
@@ -1129,7 +1217,7 @@ static int cxd2878_setTSClkModeAndFreq(struct cxd2878_dev *dev)
 	ret = cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
 	if (ret)
 		goto err;
-	ret = cxd2878_rdm(dev, dev->slvt, 0xC4, &serialTS, 1);
+	ret = cxd2878_rdc(dev, dev->slvt, 0xC4, &serialTS);
 	if (ret)
 		goto err;
 	if ((dev->system == SONY_DTV_SYSTEM_ISDBT) ||
@@ -1266,11 +1354,11 @@ static int cxd2878_setTLVClkModeAndFreq(struct cxd2878_dev *dev)
 	ret = cxd2878_wr(dev, dev->slvt, 0x00, 0x01);
 	if (ret)
 		goto err;
-	ret = cxd2878_rdm(dev, dev->slvt, 0xC1, &serialTLV, 1);
+	ret = cxd2878_rdc(dev, dev->slvt, 0xC1, &serialTLV);
 	if (ret)
 		goto err;
 	u8 twoBitParallel;
-	ret = cxd2878_rdm(dev, dev->slvt, 0xCF, &twoBitParallel, 1);
+	ret = cxd2878_rdc(dev, dev->slvt, 0xCF, &twoBitParallel);
 	if (ret)
 		goto err;
 	if ((dev->system == SONY_DTV_SYSTEM_ISDBS3) && (serialTLV & 0x80))
@@ -1341,7 +1429,7 @@ static int cxd2878_setTSDataPinHiZ(struct cxd2878_dev *dev, u8 enable)
 		goto err;
 	}
 
-	if (cxd2878_rdm(dev, dev->slvt, 0xA9, &data, 1) != 0) {
+	if (cxd2878_rdc(dev, dev->slvt, 0xA9, &data) != 0) {
 		goto err;
 	}
 
@@ -1352,7 +1440,7 @@ static int cxd2878_setTSDataPinHiZ(struct cxd2878_dev *dev, u8 enable)
 			goto err;
 		}
 
-		if (cxd2878_rdm(dev, dev->slvt, 0xC1, &data, 1) != 0) {
+		if (cxd2878_rdc(dev, dev->slvt, 0xC1, &data) != 0) {
 			goto err;
 		}
 
@@ -1369,13 +1457,12 @@ static int cxd2878_setTSDataPinHiZ(struct cxd2878_dev *dev, u8 enable)
 		case 0x00:
 		default:
 			/* Parallel TLV */
-			if (cxd2878_rdm(dev, dev->slvt, 0xCF, &data, 1) != 0) {
+			if (cxd2878_rdc(dev, dev->slvt, 0xCF, &data) != 0) {
 				goto err;
 			}
 			if (data & 0x01) {
 				/* TLV 2bit-parallel */
-				if (cxd2878_rdm(dev, dev->slvt, 0xEA, &data,
-						1) != 0) {
+				if (cxd2878_rdc(dev, dev->slvt, 0xEA, &data) != 0) {
 					goto err;
 				}
 				tsDataMask =
@@ -1392,7 +1479,7 @@ static int cxd2878_setTSDataPinHiZ(struct cxd2878_dev *dev, u8 enable)
 
 	{
 		/* TS output */
-		if (cxd2878_rdm(dev, dev->slvt, 0xC4, &data, 1) != 0) {
+		if (cxd2878_rdc(dev, dev->slvt, 0xC4, &data) != 0) {
 			goto err;
 		}
 
@@ -1438,7 +1525,11 @@ static int cxd2878_sleep(struct dvb_frontend *fe)
 {
 	struct cxd2878_dev *dev = fe->demodulator_priv;
 
+	if (dev->gate_open && !dev->gate_users)
+		cxd2878_i2c_repeater(dev, 0);
+
 	if (dev->state == SONY_DEMOD_STATE_ACTIVE) {
+		cxd2878_batch_begin(dev);
 		cxd2878_setstreamoutput(dev, 0);
 		cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
 		cxd2878_SetRegisterBits(dev, dev->slvt, 0x80, 0x1F, 0x1F);
@@ -1522,14 +1613,76 @@ static int cxd2878_sleep(struct dvb_frontend *fe)
 		default:
 			break;
 		}
+		cxd2878_batch_commit(dev);
 	}
 
 	dev->state = SONY_DEMOD_STATE_SLEEP;
 	dev->tuner_state = SONY_TUNER_STATE_NONE;
 	dev->system = SONY_DTV_SYSTEM_UNKNOWN;
+	dev->tuned_frequency = 0;
+
+	return 0;
+}
+static int __cxd2878_init(struct dvb_frontend *fe);
+static int cxd2878_init(struct dvb_frontend *fe);
+
+/* the frontend thread owns the demodulator from init until sleep */
+static int cxd2878_init_op(struct dvb_frontend *fe)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+	int ret;
+
+	mutex_lock(&dev->base->i2c_lock);
+	dev->fe_in_use = true;
+	ret = dev->scanning ? -EBUSY : __cxd2878_init(fe);
+	mutex_unlock(&dev->base->i2c_lock);
+
+	return ret;
+}
+/* the works take i2c_lock, they are stopped before the chip goes to sleep */
+static int cxd2878_sleep_op(struct dvb_frontend *fe)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+	int ret = 0;
+
+	cancel_delayed_work_sync(&dev->stats_work);
+	cancel_delayed_work_sync(&dev->gate_work);
+
+	mutex_lock(&dev->base->i2c_lock);
+	dev->fe_in_use = false;
+	/* a running scan puts the chip to sleep when it is done */
+	if (!dev->scanning)
+		ret = cxd2878_sleep(fe);
+	mutex_unlock(&dev->base->i2c_lock);
+
+	return ret;
+}
+/*
+ * The chip may lose power while suspended. Put it to sleep and forget
+ * everything cached so resume goes through a cold init; the dvb core
+ * retunes from the property cache after resume.
+ */
+static int cxd2878_suspend(struct dvb_frontend *fe)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+
+	cancel_delayed_work_sync(&dev->stats_work);
+	cancel_delayed_work_sync(&dev->gate_work);
+	mutex_lock(&dev->base->i2c_lock);
+	cxd2878_sleep(fe);
+	dev->warm = 0;
+	cxd2878_regcache_invalidate(dev);
+	mutex_unlock(&dev->base->i2c_lock);
 
 	return 0;
 }
+static int cxd2878_resume(struct dvb_frontend *fe)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+
+	dev->state = SONY_DEMOD_STATE_UNKNOWN;
+	return cxd2878_init(fe);
+}
 static int cxd2878_tuneEnd(struct cxd2878_dev *dev)
 {
 	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
@@ -1697,16 +1850,29 @@ err:
 	dev_err(&dev->base->i2c->dev, "%s: SLtoAIT error !", KBUILD_MODNAME);
 	return ret;
 }
+/*ISDB-S specific demodulator setting*/
+static void SLtoAIS_Setting(struct cxd2878_dev *dev)
+{
+	u8 dataxce[2] = { 0x00, 0x00 };
+	cxd2878_wrm(dev, dev->slvt, 0xCE, dataxce, 2);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0xae);
+	u8 datax20[3] = { 0x07, 0x37, 0x0a };
+	cxd2878_wrm(dev, dev->slvt, 0x20, datax20, 3);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0xa0);
+	cxd2878_wr(dev, dev->slvt, 0xd7, 0x00);
+}
 static int SLtoAIS(struct cxd2878_dev *dev)
 {
 	int ret = 0;
 
+	cxd2878_batch_begin(dev);
+
 	ret = cxd2878_setTSClkModeAndFreq(dev);
 	if (ret)
-		goto err;
+		goto err_batch;
 	ret = cxd2878_wr(dev, dev->slvx, 0x00, 0x00);
 	if (ret)
-		goto err;
+		goto err_batch;
 	cxd2878_wr(dev, dev->slvx, 0x17, 0x0c);
 	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
 	cxd2878_wr(dev, dev->slvt, 0x2d, 0x00);
@@ -1719,47 +1885,24 @@ static int SLtoAIS(struct cxd2878_dev *dev)
 	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
 	cxd2878_wr(dev, dev->slvt, 0x20, 0x01);
 
-	u8 dataxce[2] = { 0x00, 0x00 };
-	cxd2878_wrm(dev, dev->slvt, 0xCE, dataxce, 2);
-	cxd2878_wr(dev, dev->slvt, 0x00, 0xae);
-	u8 datax20[3] = { 0x07, 0x37, 0x0a };
-	cxd2878_wrm(dev, dev->slvt, 0x20, datax20, 3);
-	cxd2878_wr(dev, dev->slvt, 0x00, 0xa0);
-	cxd2878_wr(dev, dev->slvt, 0xd7, 0x00);
+	SLtoAIS_Setting(dev);
 	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
 	cxd2878_SetRegisterBits(dev, dev->slvt, 0x80, 0x10, 0x1F);
 	cxd2878_setTSDataPinHiZ(dev, 0);
 
+	ret = cxd2878_batch_commit(dev);
+	if (ret)
+		goto err;
 	return 0;
+err_batch:
+	cxd2878_batch_commit(dev);
 err:
 	dev_err(&dev->base->i2c->dev, "%s: SLtoAIS error !", KBUILD_MODNAME);
 	return ret;
 }
-static int SLtoAIS3(struct cxd2878_dev *dev)
+/*ISDB-S3 specific demodulator setting*/
+static void SLtoAIS3_Setting(struct cxd2878_dev *dev)
 {
-	int ret = 0;
-	u8 tlv_output = 1;
-
-	if (tlv_output)
-		ret = cxd2878_setTLVClkModeAndFreq(dev);
-	else
-		ret = cxd2878_setTSClkModeAndFreq(dev);
-	if (ret)
-		goto err;
-	ret = cxd2878_wr(dev, dev->slvx, 0x00, 0x00);
-	if (ret)
-		goto err;
-	cxd2878_wr(dev, dev->slvx, 0x17, 0x0d);
-	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
-	cxd2878_wr(dev, dev->slvt, 0x2d, 0x00);
-	cxd2878_wr(dev, dev->slvt, 0xa9, !!tlv_output);
-	cxd2878_wr(dev, dev->slvt, 0x2c, 0x01);
-	cxd2878_wr(dev, dev->slvx, 0x28, 0x31);
-	cxd2878_wr(dev, dev->slvt, 0x4b, 0x31);
-	cxd2878_wr(dev, dev->slvt, 0x6a, 0x00);
-	cxd2878_wr(dev, dev->slvx, 0x18, 0x00);
-	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
-	cxd2878_wr(dev, dev->slvt, 0x20, 0x01);
 	cxd2878_wr(dev, dev->slvt, 0x00, 0xa3);
 
 	u8 datax43[2] = { 0xb, 0xb };
@@ -1797,28 +1940,143 @@ static int SLtoAIS3(struct cxd2878_dev *dev)
 	cxd2878_wr(dev, dev->slvt, 0xc1, 0x01);
 	cxd2878_wr(dev, dev->slvt, 0x00, 0xa0);
 	cxd2878_wr(dev, dev->slvt, 0xd7, 0x00);
-	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
-	cxd2878_SetRegisterBits(dev, dev->slvt, 0x80, 0x10, 0x1F);
-	cxd2878_setTSDataPinHiZ(dev, 0);
-
-	return 0;
-err:
-	dev_err(&dev->base->i2c->dev, "%s: SLtoAIS3 error !", KBUILD_MODNAME);
-	return ret;
 }
-static int cxd2878_set_isdbt(struct dvb_frontend *fe)
+static int SLtoAIS3(struct cxd2878_dev *dev)
 {
-	struct cxd2878_dev *dev = fe->demodulator_priv;
-	struct dtv_frontend_properties *c = &fe->dtv_property_cache;
 	int ret = 0;
 
-	if (dev->base->config.LED_switch)
-		dev->base->config.LED_switch(dev->base->i2c, 5);
+	cxd2878_batch_begin(dev);
+	u8 tlv_output = 1;
 
-	dev->bandwidth = (enum sony_dtv_bandwidth_t)(c->bandwidth_hz / 1000000);
-	if ((dev->state == SONY_DEMOD_STATE_ACTIVE) &&
-	    (dev->system == SONY_DTV_SYSTEM_ISDBT)) {
-		/* Demodulator Active and set to ISDB-T mode */
+	if (tlv_output)
+		ret = cxd2878_setTLVClkModeAndFreq(dev);
+	else
+		ret = cxd2878_setTSClkModeAndFreq(dev);
+	if (ret)
+		goto err_batch;
+	ret = cxd2878_wr(dev, dev->slvx, 0x00, 0x00);
+	if (ret)
+		goto err_batch;
+	cxd2878_wr(dev, dev->slvx, 0x17, 0x0d);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+	cxd2878_wr(dev, dev->slvt, 0x2d, 0x00);
+	cxd2878_wr(dev, dev->slvt, 0xa9, !!tlv_output);
+	cxd2878_wr(dev, dev->slvt, 0x2c, 0x01);
+	cxd2878_wr(dev, dev->slvx, 0x28, 0x31);
+	cxd2878_wr(dev, dev->slvt, 0x4b, 0x31);
+	cxd2878_wr(dev, dev->slvt, 0x6a, 0x00);
+	cxd2878_wr(dev, dev->slvx, 0x18, 0x00);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+	cxd2878_wr(dev, dev->slvt, 0x20, 0x01);
+
+	SLtoAIS3_Setting(dev);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+	cxd2878_SetRegisterBits(dev, dev->slvt, 0x80, 0x10, 0x1F);
+	cxd2878_setTSDataPinHiZ(dev, 0);
+
+	ret = cxd2878_batch_commit(dev);
+	if (ret)
+		goto err;
+	return 0;
+err_batch:
+	cxd2878_batch_commit(dev);
+err:
+	dev_err(&dev->base->i2c->dev, "%s: SLtoAIS3 error !", KBUILD_MODNAME);
+	return ret;
+}
+/*
+ * Direct switches between active ISDB-S and ISDB-S3. These give the same
+ * final register values as cxd2878_sleep() followed by SLtoAIS()/SLtoAIS3(),
+ * but leave out the registers both modes program identically and the
+ * power down/up of the ADC and demodulator clock in between. The
+ * demodulator is reset by cxd2878_tuneEnd() afterwards as usual.
+ */
+static int AIS3toAIS(struct cxd2878_dev *dev)
+{
+	int ret;
+
+	cxd2878_batch_begin(dev);
+
+	cxd2878_setstreamoutput(dev, 0);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+	cxd2878_SetRegisterBits(dev, dev->slvt, 0x80, 0x1F, 0x1F);
+	cxd2878_setTSDataPinHiZ(dev, 1);
+
+	cxd2878_wr(dev, dev->slvt, 0x00, 0xa3);
+	u8 datax43[2] = { 0x0a, 0x0a };
+	cxd2878_wrm(dev, dev->slvt, 0x43, datax43, 2);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+	cxd2878_wr(dev, dev->slvt, 0xa9, 0x00);
+
+	ret = cxd2878_setTSClkModeAndFreq(dev);
+	if (ret)
+		goto err_batch;
+	cxd2878_wr(dev, dev->slvx, 0x00, 0x00);
+	cxd2878_wr(dev, dev->slvx, 0x17, 0x0c);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+
+	SLtoAIS_Setting(dev);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+	cxd2878_SetRegisterBits(dev, dev->slvt, 0x80, 0x10, 0x1F);
+	cxd2878_setTSDataPinHiZ(dev, 0);
+
+	ret = cxd2878_batch_commit(dev);
+	if (ret)
+		goto err;
+	return 0;
+err_batch:
+	cxd2878_batch_commit(dev);
+err:
+	dev_err(&dev->base->i2c->dev, "%s: AIS3toAIS error !", KBUILD_MODNAME);
+	return ret;
+}
+static int AIStoAIS3(struct cxd2878_dev *dev)
+{
+	int ret;
+
+	cxd2878_batch_begin(dev);
+
+	cxd2878_setstreamoutput(dev, 0);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+	cxd2878_SetRegisterBits(dev, dev->slvt, 0x80, 0x1F, 0x1F);
+	cxd2878_setTSDataPinHiZ(dev, 1);
+
+	ret = cxd2878_setTLVClkModeAndFreq(dev);
+	if (ret)
+		goto err_batch;
+	cxd2878_wr(dev, dev->slvx, 0x00, 0x00);
+	cxd2878_wr(dev, dev->slvx, 0x17, 0x0d);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+	cxd2878_wr(dev, dev->slvt, 0xa9, 0x01);
+
+	SLtoAIS3_Setting(dev);
+	cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
+	cxd2878_SetRegisterBits(dev, dev->slvt, 0x80, 0x10, 0x1F);
+	cxd2878_setTSDataPinHiZ(dev, 0);
+
+	ret = cxd2878_batch_commit(dev);
+	if (ret)
+		goto err;
+	return 0;
+err_batch:
+	cxd2878_batch_commit(dev);
+err:
+	dev_err(&dev->base->i2c->dev, "%s: AIStoAIS3 error !", KBUILD_MODNAME);
+	return ret;
+}
+static int cxd2878_set_isdbt(struct dvb_frontend *fe)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+	struct dtv_frontend_properties *c = &fe->dtv_property_cache;
+	int ret = 0;
+
+	if (dev->base->config.LED_switch)
+		dev->base->config.LED_switch(dev->base->i2c, 5);
+
+	dev->bandwidth = (enum sony_dtv_bandwidth_t)(c->bandwidth_hz / 1000000);
+	if ((dev->state == SONY_DEMOD_STATE_ACTIVE) &&
+	    (dev->system == SONY_DTV_SYSTEM_ISDBT)) {
+		/* Demodulator Active and set to ISDB-T mode */
 		cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
 		cxd2878_wr(dev, dev->slvt, 0xc3, 0x01);
 		SLtoAIT_BandSetting(dev);
@@ -1873,6 +2131,14 @@ static int cxd2878_set_isdbs(struct dvb_frontend *fe, u16 stream_id)
 		cxd2878_set_tsid(fe, stream_id);
 		cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
 		cxd2878_wr(dev, dev->slvt, 0xc3, 0x01);
+	} else if ((dev->state == SONY_DEMOD_STATE_ACTIVE) &&
+		   (dev->system == SONY_DTV_SYSTEM_ISDBS3)) {
+		/* Demodulator Active and set to ISDB-S3 mode */
+		cxd2878_set_tsid(fe, stream_id);
+		dev->system = SONY_DTV_SYSTEM_ISDBS;
+		ret = AIS3toAIS(dev);
+		if (ret)
+			goto err;
 	} else if ((dev->state == SONY_DEMOD_STATE_ACTIVE) &&
 		   (dev->system != SONY_DTV_SYSTEM_ISDBS)) {
 		/* Demodulator Active but not ISDB-S mode */
@@ -1909,33 +2175,52 @@ static void cxd2878_set_stream_id(struct dvb_frontend *fe, u16 stream_id)
 	cxd2878_wrm(dev, dev->slvt, 0x87, data, 2);
 }
 
+/*
+ * Called with i2c_lock held, polls with a growing interval. The lock is
+ * dropped while sleeping so the other frontends on the bus are not held
+ * off for up to 2 s; tmcc_waiting keeps read_status, stats_work and
+ * cxd2857_get_tmcc() away from the half configured demodulator.
+ */
 static int cxd2878_wait_isdbs3_tmcc_lock(struct dvb_frontend* fe) {
 	int ret = 0;
 	struct cxd2878_dev *dev = fe->demodulator_priv;
+	unsigned long timeout = jiffies + msecs_to_jiffies(2000);
+	unsigned int poll_ms = 5;
 
 	if (dev->state != SONY_DEMOD_STATE_ACTIVE) {
 		ret = -EINVAL;
 		goto err;
 	}
 
-	for (int i = 0; i < 200; i++) {
-		u8 data3[3];
-		cxd2878_wr(dev, dev->slvt, 0x00, 0xa0);
-		cxd2878_rdm(dev, dev->slvt, 0x10, data3, 2);
+	for (;;) {
+		u8 data3[2];
+		ret = cxd2878_wr(dev, dev->slvt, 0x00, 0xa0);
+		ret |= cxd2878_rdm(dev, dev->slvt, 0x10, data3, 2);
+		if (ret)
+			goto err;
 		u8 tmcclockstat = (u8)((data3[1] & 0x80) ? 1 : 0);
 		if (tmcclockstat) {
-			return ret;
+			cxd2878_trace_phase(dev, CXD2857_PHASE_TMCC_LOCK);
+			return 0;
 		}
-		msleep(10);
+		if (time_after(jiffies, timeout))
+			break;
+
+		dev->tmcc_waiting = true;
+		mutex_unlock(&dev->base->i2c_lock);
+		msleep(poll_ms);
+		mutex_lock(&dev->base->i2c_lock);
+		dev->tmcc_waiting = false;
+		poll_ms = min(poll_ms * 2, 40U);
 	}
-	ret = -EINVAL;
+	ret = -ETIMEDOUT;
 
 err:
 	dev_err(&dev->base->i2c->dev, "%s: wait isdbs3 tmcc lock error !", KBUILD_MODNAME);
 	return ret;
 }
 
-static int cxd2878_get_isdbs3_tmcc(struct dvb_frontend *fe, struct tmcc_stream_infos* tmcc) {
+static int cxd2878_get_isdbs3_tmcc(struct dvb_frontend *fe, struct cxd2857_tmcc *tmcc) {
 	struct cxd2878_dev *dev = fe->demodulator_priv;
 	int ret = 0;
 
@@ -1967,9 +2252,13 @@ static int cxd2878_get_isdbs3_tmcc(struct dvb_frontend *fe, struct tmcc_stream_i
 	if (ret)
 		goto err_with_unfreezing;
 
+	memset(tmcc, 0, sizeof(*tmcc));
+	tmcc->isdbs3 = true;
+	tmcc->nr_streams = 16;
+
 	int pos = 25;
 	for (int i=0; i < 16; i++) {
-		tmcc->stream_info[i].stream_type = tmcc_data[pos];
+		tmcc->streams.stream_info[i].stream_type = tmcc_data[pos];
 		pos++;
 	}
 
@@ -1982,10 +2271,10 @@ static int cxd2878_get_isdbs3_tmcc(struct dvb_frontend *fe, struct tmcc_stream_i
 
 	pos = 213;
 	for (int i = 0; i < 13; i++) {
-		tmcc->stream_info[i].stream_id = (u16)((tmcc_data[pos] << 8) | tmcc_data[pos + 1]);
+		tmcc->streams.stream_info[i].stream_id = (u16)((tmcc_data[pos] << 8) | tmcc_data[pos + 1]);
 		pos += 2;
 	}
-	tmcc->stream_info[13].stream_id = (u16)(tmcc_data[pos] << 8);
+	tmcc->streams.stream_info[13].stream_id = (u16)(tmcc_data[pos] << 8);
 
 	ret = cxd2878_wr(dev, dev->slvt, 0x00, 0xde);
 	if (ret)
@@ -1995,10 +2284,10 @@ static int cxd2878_get_isdbs3_tmcc(struct dvb_frontend *fe, struct tmcc_stream_i
 		goto err_with_unfreezing;
 
 	pos = 0;
-	tmcc->stream_info[13].stream_id |= tmcc_data[pos];
+	tmcc->streams.stream_info[13].stream_id |= tmcc_data[pos];
 	pos++;
 	for (int i = 0; i < 2; i++) {
-		tmcc->stream_info[14 + i].stream_id = (u16)((tmcc_data[pos] << 8) | tmcc_data[pos + 1]);
+		tmcc->streams.stream_info[14 + i].stream_id = (u16)((tmcc_data[pos] << 8) | tmcc_data[pos + 1]);
 		pos += 2;
 	}
 
@@ -2042,6 +2331,14 @@ static int cxd2878_set_isdbs3(struct dvb_frontend *fe, u16 stream_id)
 			cxd2878_wr(dev, dev->slvt, 0x00, 0x00);
 			cxd2878_wr(dev, dev->slvt, 0xc3, 0x01);
 		}
+	} else if ((dev->state == SONY_DEMOD_STATE_ACTIVE) &&
+		   (dev->system == SONY_DTV_SYSTEM_ISDBS)) {
+		/* Demodulator Active and set to ISDB-S mode */
+		cxd2878_set_stream_id(fe, stream_id);
+		dev->system = SONY_DTV_SYSTEM_ISDBS3;
+		ret = AIStoAIS3(dev);
+		if (ret)
+			goto err;
 	} else if ((dev->state == SONY_DEMOD_STATE_ACTIVE) &&
 		   (dev->system != SONY_DTV_SYSTEM_ISDBS3)) {
 		/* Demodulator Active but not ISDB-S3 mode */
@@ -2070,21 +2367,27 @@ err:
 	return ret;
 }
 
-static int cxd2878_init(struct dvb_frontend *fe)
+/*called with i2c_lock held*/
+static int __cxd2878_init(struct dvb_frontend *fe)
 {
 	struct cxd2878_dev *dev = fe->demodulator_priv;
 	struct dtv_frontend_properties *c = &fe->dtv_property_cache;
 
 	int ret;
 
-	mutex_lock(&dev->base->i2c_lock);
-
 	if (dev->warm)
 		goto warm_start;
+
+	cxd2878_batch_begin(dev);
 	//clear all registers
 	ret = cxd2878_wr(dev, dev->slvx, 0x02, 0x00);
+	if (!ret)
+		ret = cxd2878_batch_flush(dev);
 	if (ret)
-		goto err;
+		goto err_batch;
+	dev->gate_open = false;
+	if (dev->base->gate_dev == dev)
+		dev->base->gate_dev = NULL;
 
 	msleep(4);
 
@@ -2098,25 +2401,29 @@ static int cxd2878_init(struct dvb_frontend *fe)
 	/* Clock mode setting */
 	cxd2878_wr(dev, dev->slvx, 0x14, dev->base->config.xtal);
 	cxd2878_wr(dev, dev->slvx, 0x1c, 0x03);
+	cxd2878_batch_flush(dev);
 	msleep(6);
 	cxd2878_wr(dev, dev->slvx, 0x50, 0x00);
+	cxd2878_batch_flush(dev);
 	msleep(5);
 	cxd2878_wr(dev, dev->slvx, 0x10, 0x00);
+	cxd2878_batch_flush(dev);
 	msleep(5);
 
 	dev->state = SONY_DEMOD_STATE_SLEEP;
 
 	/*setup tuner i2c bus*/
 	cxd2878_SetBankAndRegisterBits(dev, dev->slvx, 0x00, 0x1A, 0x01, 0xFF);
+	cxd2878_batch_flush(dev);
 	msleep(2);
 
 	//init internal tuner
-	cxd2878_i2c_repeater(dev, 1);
+	cxd2878_gate_get(dev);
 
 	if (dev->chipid == SONY_DEMOD_CHIP_ID_CXD2857)
 		cxd2857_init(dev);
 
-	cxd2878_i2c_repeater(dev, 0);
+	cxd2878_gate_put(dev);
 
 	if (dev->chipid == SONY_DEMOD_CHIP_ID_CXD2857 &&
 	    dev->base->config.tlv_mode) {
@@ -2146,9 +2453,13 @@ static int cxd2878_init(struct dvb_frontend *fe)
 					       0);
 	} else {
 		ret = -EINVAL;
-		goto err;
+		goto err_batch;
 	}
 
+	ret = cxd2878_batch_commit(dev);
+	if (ret)
+		goto err;
+
 warm_start:
 	dev->warm = 1;
 
@@ -2159,31 +2470,35 @@ warm_start:
 	c->post_bit_count.len = 1;
 	c->post_bit_count.stat[0].scale = FE_SCALE_NOT_AVAILABLE;
 
-	mutex_unlock(&dev->base->i2c_lock);
-
 	return 0;
+err_batch:
+	cxd2878_batch_commit(dev);
 err:
-	mutex_unlock(&dev->base->i2c_lock);
 	dev_err(&dev->base->i2c->dev, "%s:Init failed!", KBUILD_MODNAME);
 
 	return ret;
 }
+static int cxd2878_init(struct dvb_frontend *fe)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+	int ret;
+
+	mutex_lock(&dev->base->i2c_lock);
+	ret = __cxd2878_init(fe);
+	mutex_unlock(&dev->base->i2c_lock);
+
+	return ret;
+}
 
-static int cxd2878_read_status(struct dvb_frontend *fe, enum fe_status *status)
+/*demodulator lock state only, called with i2c_lock held*/
+static int cxd2878_read_lock(struct dvb_frontend *fe, enum fe_status *status)
 {
 	struct cxd2878_dev *dev = fe->demodulator_priv;
 	struct dtv_frontend_properties *c = &fe->dtv_property_cache;
-	int ret = 0;
 	u8 data = 0;
 	u8 syncstat, tslockstat, unlockdetected;
-	u32 per = 0;
-	u8 tmp[2];
-	u16 tmp16 = 0;
-	s32 rflevel, snr = 0;
 	u8 data3[3];
 
-	mutex_lock(&dev->base->i2c_lock);
-
 	*status = 0;
 	switch (c->delivery_system) {
 	case SYS_ISDBT:
@@ -2231,60 +2546,80 @@ static int cxd2878_read_status(struct dvb_frontend *fe, enum fe_status *status)
 		break;
 	}
 	default:
-		ret = -EINVAL;
-		goto err;
+		return -EINVAL;
 	}
 
+	if ((*status & FE_HAS_LOCK) && !dev->ts_locked) {
+		dev->ts_locked = true;
+		cxd2878_trace_phase(dev, CXD2857_PHASE_TS_LOCK);
+	}
+
+	return 0;
+}
+
+/*
+ * RF level, CNR and PER into the dev->strength, ... cache, called with
+ * i2c_lock held. The ISDB-T RF level needs the tuner behind the i2c
+ * repeater, which costs gate_settle_ms unless it is still open.
+ */
+static int cxd2878_read_stats(struct dvb_frontend *fe, enum fe_status *status)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+	struct dtv_frontend_properties *c = &fe->dtv_property_cache;
+	int ret = 0;
+	u8 tmp[2];
+	u16 tmp16 = 0;
+	s32 rflevel, snr = 0;
+	u32 per = 0;
+
 	/*rf signal*/
-	c->strength.len = 0;
+	dev->strength.len = 0;
 	switch (c->delivery_system) {
 	case SYS_ISDBT:
-		ret |= cxd2878_i2c_repeater(dev, 1);
+		ret |= cxd2878_gate_get(dev);
 		ret |= cxd2857_read_rssi_isdbt(dev, c->frequency / 1000,
 					       &rflevel);
-		ret |= cxd2878_i2c_repeater(dev, 0);
-		c->strength.len = 1;
-		c->strength.stat[0].scale = FE_SCALE_DECIBEL;
-		c->strength.stat[0].svalue = rflevel * 10 - 4500;
+		cxd2878_gate_put(dev);
+		dev->strength.len = 1;
+		dev->strength.stat[0].scale = FE_SCALE_DECIBEL;
+		dev->strength.stat[0].svalue = rflevel * 10 - 4500;
 		break;
 	case SYS_ISDBS:
 		ret |= cxd2857_read_rflevel_isdbs(dev, c->frequency, &rflevel);
-		c->strength.len = 1;
-		c->strength.stat[0].scale = FE_SCALE_DECIBEL;
-		c->strength.stat[0].svalue = rflevel;
+		dev->strength.len = 1;
+		dev->strength.stat[0].scale = FE_SCALE_DECIBEL;
+		dev->strength.stat[0].svalue = rflevel;
 		break;
 	default:
 		break;
 	}
 
-	c->cnr.len = 1;
-	c->cnr.stat[0].scale = FE_SCALE_NOT_AVAILABLE;
+	dev->cnr.len = 1;
+	dev->cnr.stat[0].scale = FE_SCALE_NOT_AVAILABLE;
 
 	switch (c->delivery_system) {
 	case SYS_ISDBS:
 		if (dev->symbol_rate >= 33750000) {
 			ret |= cxd2857_read_cnr_isdbs3(dev,
-						       &c->cnr.stat[0].svalue);
+						       &dev->cnr.stat[0].svalue);
 		} else {
 			ret |= cxd2857_read_cnr_isdbs(dev,
-						      &c->cnr.stat[0].svalue);
+						      &dev->cnr.stat[0].svalue);
 		}
 		if (!ret) {
-			c->cnr.len = 1;
-			c->cnr.stat[0].scale = FE_SCALE_DECIBEL;
+			dev->cnr.len = 1;
+			dev->cnr.stat[0].scale = FE_SCALE_DECIBEL;
 		}
 		ret = 0;
 		break;
 	default:
 		break;
 	}
-	if (!(*status & FE_HAS_LOCK)) {
-		mutex_unlock(&dev->base->i2c_lock);
+	if (!(*status & FE_HAS_LOCK))
 		return ret;
-	}
 
 	if ((*status & FE_HAS_VITERBI) &&
-	    c->cnr.stat[0].scale == FE_SCALE_NOT_AVAILABLE) {
+	    dev->cnr.stat[0].scale == FE_SCALE_NOT_AVAILABLE) {
 		switch (c->delivery_system) {
 		case SYS_ISDBT:
 			cxd2878_wr(dev, dev->slvt, 0x00, 0x60);
@@ -2295,15 +2630,15 @@ static int cxd2878_read_status(struct dvb_frontend *fe, enum fe_status *status)
 		default:
 			break;
 		}
-		c->cnr.len = 2;
-		c->cnr.stat[0].scale = FE_SCALE_DECIBEL;
-		c->cnr.stat[0].uvalue = snr - 1500;
-		c->cnr.stat[1].scale = FE_SCALE_RELATIVE;
-		c->cnr.stat[1].uvalue = (30 - ((snr - 1500) / 1000)) * 10;
-		c->cnr.stat[1].uvalue =
+		dev->cnr.len = 2;
+		dev->cnr.stat[0].scale = FE_SCALE_DECIBEL;
+		dev->cnr.stat[0].uvalue = snr - 1500;
+		dev->cnr.stat[1].scale = FE_SCALE_RELATIVE;
+		dev->cnr.stat[1].uvalue = (30 - ((snr - 1500) / 1000)) * 10;
+		dev->cnr.stat[1].uvalue =
 			min(max((snr - 1500) / 1000 * 24 / 10, 0), 100) * 656;
-		if (c->cnr.stat[1].uvalue > 0xffff)
-			c->cnr.stat[1].uvalue = 0xffff;
+		if (dev->cnr.stat[1].uvalue > 0xffff)
+			dev->cnr.stat[1].uvalue = 0xffff;
 	}
 
 	if (*status & FE_HAS_LOCK) {
@@ -2319,6 +2654,8 @@ static int cxd2878_read_status(struct dvb_frontend *fe, enum fe_status *status)
 				((u32)datapacketnum[0] << 8) + datapacketnum[1];
 			packeterr =
 				((u32)datapacketerr[0] << 8) + datapacketerr[1];
+			if (!period)
+				break;
 			Q = (packeterr * 1000) / period;
 			R = (packeterr * 1000) % period;
 			R *= 1000;
@@ -2329,21 +2666,88 @@ static int cxd2878_read_status(struct dvb_frontend *fe, enum fe_status *status)
 			else
 				per = Q;
 
+			dev->post_bit_error.stat[0].scale = FE_SCALE_COUNTER;
+			dev->post_bit_error.stat[0].uvalue = per;
+			dev->post_bit_count.stat[0].scale = FE_SCALE_COUNTER;
+			dev->post_bit_count.stat[0].uvalue = per;
 			break;
 		default:
 			break;
 		}
-		c->post_bit_error.stat[0].scale = FE_SCALE_COUNTER;
-		c->post_bit_error.stat[0].uvalue = per;
-		c->post_bit_count.stat[0].scale = FE_SCALE_COUNTER;
-		c->post_bit_count.stat[0].uvalue = per;
 	}
 
-	c->post_bit_count.len = 1;
-	c->post_bit_error.len = 1;
+	dev->post_bit_count.len = 1;
+	dev->post_bit_error.len = 1;
+
+	return 0;
+}
+
+static void cxd2878_stats_work(struct work_struct *work)
+{
+	struct cxd2878_dev *dev =
+		container_of(to_delayed_work(work), struct cxd2878_dev,
+			     stats_work);
+	enum fe_status status;
 
+	mutex_lock(&dev->base->i2c_lock);
+	if (dev->state == SONY_DEMOD_STATE_ACTIVE && !dev->scanning &&
+	    !dev->tmcc_waiting &&
+	    !cxd2878_read_lock(&dev->fe, &status))
+		cxd2878_read_stats(&dev->fe, &status);
 	mutex_unlock(&dev->base->i2c_lock);
 
+	if (stats_interval_ms)
+		queue_delayed_work(system_power_efficient_wq, &dev->stats_work,
+				   msecs_to_jiffies(stats_interval_ms));
+}
+
+static void cxd2878_reset_stats(struct cxd2878_dev *dev)
+{
+	dev->strength.len = 0;
+	dev->cnr.len = 1;
+	dev->cnr.stat[0].scale = FE_SCALE_NOT_AVAILABLE;
+	dev->post_bit_error.len = 1;
+	dev->post_bit_error.stat[0].scale = FE_SCALE_NOT_AVAILABLE;
+	dev->post_bit_count.len = 1;
+	dev->post_bit_count.stat[0].scale = FE_SCALE_NOT_AVAILABLE;
+}
+
+/*
+ * Only the lock state is read here, the statistics come from the last
+ * run of stats_work unless stats_interval_ms is 0. stats_work is
+ * started here when the interval was switched on since the last tune.
+ */
+static int cxd2878_read_status(struct dvb_frontend *fe, enum fe_status *status)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+	struct dtv_frontend_properties *c = &fe->dtv_property_cache;
+	int ret;
+
+	mutex_lock(&dev->base->i2c_lock);
+
+	if (dev->scanning || dev->tmcc_waiting) {
+		*status = 0;
+		mutex_unlock(&dev->base->i2c_lock);
+		return 0;
+	}
+
+	ret = cxd2878_read_lock(fe, status);
+	if (ret)
+		goto err;
+
+	if (!stats_interval_ms)
+		cxd2878_read_stats(fe, status);
+
+	c->strength = dev->strength;
+	c->cnr = dev->cnr;
+	c->post_bit_error = dev->post_bit_error;
+	c->post_bit_count = dev->post_bit_count;
+
+	mutex_unlock(&dev->base->i2c_lock);
+
+	if (stats_interval_ms && !delayed_work_pending(&dev->stats_work))
+		queue_delayed_work(system_power_efficient_wq, &dev->stats_work, 0);
+
 	return 0;
 err:
 	mutex_unlock(&dev->base->i2c_lock);
@@ -2364,8 +2768,21 @@ static int cxd2878_set_frontend(struct dvb_frontend *fe)
 
 	mutex_lock(&dev->base->i2c_lock);
 
-	if (!dev->warm)
-		cxd2878_init(fe);
+	if (dev->scanning) {
+		ret = -EBUSY;
+		goto err;
+	}
+
+	dev->tune_start = ktime_get();
+	dev->ts_locked = false;
+	cxd2878_reset_stats(dev);
+	cxd2878_trace_phase(dev, CXD2857_PHASE_SET_FRONTEND);
+
+	if (!dev->warm) {
+		ret = __cxd2878_init(fe);
+		if (ret)
+			goto err;
+	}
 
 	if (dev->base->config.RF_switch)
 		dev->base->config.RF_switch(dev->base->i2c,
@@ -2375,6 +2792,8 @@ static int cxd2878_set_frontend(struct dvb_frontend *fe)
 
 	u16 tsid = (u16)c->stream_id;
 	u16 tsid_mode = c->stream_id >> 16;
+	enum sony_dtv_system_t prev_system = dev->system;
+	bool active = dev->state == SONY_DEMOD_STATE_ACTIVE;
 
 	switch (c->delivery_system) {
 	case SYS_ISDBT:
@@ -2404,39 +2823,61 @@ static int cxd2878_set_frontend(struct dvb_frontend *fe)
 		goto err;
 	}
 
+	/*
+	 * Another TS/stream on the carrier the tuner is already on: only
+	 * the id has been rewritten above, restart the demodulator.
+	 */
+	if (c->delivery_system == SYS_ISDBS && active && !ret &&
+	    dev->system == prev_system &&
+	    dev->tuned_frequency == c->frequency) {
+		ret = cxd2878_tuneEnd(dev);
+		if (ret)
+			goto err;
+		goto stream_select;
+	}
+
 	// set tuner
-	ret |= cxd2878_i2c_repeater(dev, 1);
+	dev->tuned_frequency = 0;
+	ret |= cxd2878_gate_get(dev);
 	if (dev->chipid == SONY_DEMOD_CHIP_ID_CXD2857)
 		ret |= cxd2857_tune(dev, c->frequency); //unit khz
 
-	ret |= cxd2878_i2c_repeater(dev, 0);
+	cxd2878_gate_put(dev);
+	cxd2878_trace_phase(dev, CXD2857_PHASE_TUNER);
 	ret |= cxd2878_tuneEnd(dev);
 
 	if (ret)
 		goto err;
+	dev->tuned_frequency = c->frequency;
+
+stream_select:
 
 	// if the stream id is less than 16, it is a relative ISDB-S3 stream number
-	// get the stream id from TMCC
+	// get the stream id from TMCC, read again on every tune: without a
+	// verified change indicator a kept copy could go stale on the carrier
 	if (c->delivery_system == SYS_ISDBS && tsid_mode == 0x0003 && tsid < 16) {
-		struct tmcc_stream_infos tmcc;
+		struct cxd2857_tmcc tmcc;
+
 		ret |= cxd2878_wait_isdbs3_tmcc_lock(fe);
 		ret |= cxd2878_get_isdbs3_tmcc(fe, &tmcc);
 
 #ifdef DEBUG
 		for (int i = 0; i < 16; i++) {
-			dev_dbg(&dev->base->i2c->dev, "tmcc(%d): stream_id=%d stream_type=%d\n", i, tmcc.stream_info[i].stream_id, tmcc.stream_info[i].stream_type);
+			dev_dbg(&dev->base->i2c->dev, "tmcc(%d): stream_id=%d stream_type=%d\n", i, tmcc.streams.stream_info[i].stream_id, tmcc.streams.stream_info[i].stream_type);
 		}
 #endif
 
 		if (ret)
 			goto err;
 
-		cxd2878_set_stream_id(fe, tmcc.stream_info[tsid].stream_id);
+		cxd2878_set_stream_id(fe, tmcc.streams.stream_info[tsid].stream_id);
 	}
 
 	mutex_unlock(&dev->base->i2c_lock);
 
-	msleep(20);
+	if (stats_interval_ms)
+		mod_delayed_work(system_power_efficient_wq, &dev->stats_work,
+				 msecs_to_jiffies(stats_interval_ms));
 
 	return 0;
 err:
@@ -2445,6 +2886,17 @@ err:
 		KBUILD_MODNAME);
 	return ret;
 }
+static unsigned long cxd2878_lock_timeout(struct cxd2878_dev *dev)
+{
+	switch (dev->system) {
+	case SONY_DTV_SYSTEM_ISDBS3:
+		return msecs_to_jiffies(2000);
+	case SONY_DTV_SYSTEM_ISDBS:
+	case SONY_DTV_SYSTEM_ISDBT:
+	default:
+		return msecs_to_jiffies(1500);
+	}
+}
 static int cxd2878_tune(struct dvb_frontend *fe, bool re_tune,
 			unsigned int mode_flags, unsigned int *delay,
 			enum fe_status *status)
@@ -2457,6 +2909,31 @@ static int cxd2878_tune(struct dvb_frontend *fe, bool re_tune,
 		if (ret)
 			return ret;
 		dev->tune_time = jiffies;
+		dev->lock_poll = CXD2878_LOCK_POLL_MIN;
+	}
+
+	/*
+	 * Until the demodulator locks or the lock timeout of the system
+	 * expires, only poll the lock registers with an increasing delay
+	 * so the lock is reported as soon as it happens.
+	 */
+	if (dev->lock_poll) {
+		mutex_lock(&dev->base->i2c_lock);
+		ret = cxd2878_read_lock(fe, status);
+		mutex_unlock(&dev->base->i2c_lock);
+		if (ret)
+			return ret;
+
+		if (!(*status & FE_HAS_LOCK) &&
+		    time_before(jiffies, dev->tune_time +
+				cxd2878_lock_timeout(dev))) {
+			*delay = dev->lock_poll;
+			dev->lock_poll = min_t(unsigned long,
+					       dev->lock_poll * 2,
+					       CXD2878_LOCK_POLL_MAX);
+			return 0;
+		}
+		dev->lock_poll = 0;
 	}
 	*delay = HZ;
 
@@ -2610,11 +3087,23 @@ static void cxd2878_eeprom_write(struct dvb_frontend *fe,
 static void cxd2878_release(struct dvb_frontend *fe)
 {
 	struct cxd2878_dev *dev = fe->demodulator_priv;
+
+	cancel_delayed_work_sync(&dev->stats_work);
+	cancel_delayed_work_sync(&dev->gate_work);
+	debugfs_remove_recursive(dev->debugfs);
+
+	mutex_lock(&dev->base->i2c_lock);
+	if (dev->base->gate_dev == dev)
+		dev->base->gate_dev = NULL;
+	mutex_unlock(&dev->base->i2c_lock);
+
+	mutex_lock(&cxdlist_lock);
 	dev->base->count--;
 	if (dev->base->count == 0) {
 		list_del(&dev->base->cxdlist);
 		kfree(dev->base);
 	}
+	mutex_unlock(&cxdlist_lock);
 	kfree(dev);
 }
 
@@ -2646,8 +3135,10 @@ static const struct dvb_frontend_ops cxd2878_ops = {
 				FE_CAN_MUTE_TS,
 	},
 
-			.init 				= cxd2878_init,
-			.sleep				= cxd2878_sleep,
+			.init 				= cxd2878_init_op,
+			.sleep				= cxd2878_sleep_op,
+			.suspend			= cxd2878_suspend,
+			.resume				= cxd2878_resume,
 			.release			= cxd2878_release,
 			.set_frontend			= cxd2878_set_frontend,
 			.tune				= cxd2878_tune,
@@ -2669,6 +3160,417 @@ static const struct dvb_frontend_ops cxd2878_ops = {
 #endif
 };
 
+/*
+ * Read the stream list from the TMCC of the current ISDB-S3 carrier so
+ * all TLV streams on a transponder can be listed after one tune. ISDB-S
+ * TSID enumeration is not supported: the location of its TMCC in the
+ * demodulator is not known, so -EOPNOTSUPP is returned on ISDB-S.
+ */
+int cxd2857_get_tmcc(struct dvb_frontend *fe, struct cxd2857_tmcc *tmcc)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+	int ret;
+
+	mutex_lock(&dev->base->i2c_lock);
+	if (dev->tmcc_waiting) {
+		mutex_unlock(&dev->base->i2c_lock);
+		return -EBUSY;
+	}
+	switch (dev->system) {
+	case SONY_DTV_SYSTEM_ISDBS:
+		ret = -EOPNOTSUPP;
+		break;
+	case SONY_DTV_SYSTEM_ISDBS3:
+		ret = cxd2878_get_isdbs3_tmcc(fe, tmcc);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+	mutex_unlock(&dev->base->i2c_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(cxd2857_get_tmcc);
+
+static int cxd2878_tmcc_show(struct seq_file *s, void *unused)
+{
+	struct cxd2878_dev *dev = s->private;
+	struct cxd2857_tmcc *tmcc;
+	int i, ret;
+
+	tmcc = kmalloc(sizeof(*tmcc), GFP_KERNEL);
+	if (!tmcc)
+		return -ENOMEM;
+
+	ret = cxd2857_get_tmcc(&dev->fe, tmcc);
+	if (ret)
+		goto out;
+
+	seq_puts(s, "stream  stream_id  stream_type\n");
+	for (i = 0; i < tmcc->nr_streams; i++)
+		seq_printf(s, "%6d  0x%04x     0x%02x\n", i,
+			   tmcc->streams.stream_info[i].stream_id,
+			   tmcc->streams.stream_info[i].stream_type);
+out:
+	kfree(tmcc);
+	return ret;
+}
+
+static int cxd2878_tmcc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cxd2878_tmcc_show, inode->i_private);
+}
+
+static const struct file_operations cxd2878_tmcc_fops = {
+	.owner   = THIS_MODULE,
+	.open    = cxd2878_tmcc_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * The scans retune the demodulator behind the frontend's back. They are
+ * refused while the frontend is in use, and the frontend thread gets
+ * -EBUSY until the scan is over. Called with i2c_lock held.
+ */
+static int cxd2878_scan_begin(struct cxd2878_dev *dev)
+{
+	struct dtv_frontend_properties *c = &dev->fe.dtv_property_cache;
+	int ret;
+
+	if (dev->fe_in_use || dev->scanning)
+		return -EBUSY;
+
+	ret = __cxd2878_init(&dev->fe);
+	if (ret)
+		return ret;
+
+	dev->scanning = true;
+	dev->scan_symbol_rate = c->symbol_rate;
+	dev->scan_bandwidth_hz = c->bandwidth_hz;
+	if (dev->base->config.RF_switch)
+		dev->base->config.RF_switch(dev->base->i2c,
+					    dev->base->config.rf_port, 1);
+	return 0;
+}
+
+/* back to sleep like the idle frontend, which also forgets the carrier */
+static void cxd2878_scan_end(struct cxd2878_dev *dev)
+{
+	struct dtv_frontend_properties *c = &dev->fe.dtv_property_cache;
+
+	cxd2878_sleep(&dev->fe);
+	c->symbol_rate = dev->scan_symbol_rate;
+	c->bandwidth_hz = dev->scan_bandwidth_hz;
+	dev->scanning = false;
+}
+
+/* BS right-hand odd, BS left-hand even and 110E CS ND2-ND24, IF in kHz */
+static const u32 cxd2878_sat_plan[] = {
+	1049480, 1087840, 1126200, 1164560, 1202920, 1241280,
+	1279640, 1318000, 1356360, 1394720, 1433080, 1471440,
+	2236660, 2275020, 2313380, 2351740, 2390100, 2428460,
+	2466820, 2505180, 2543540, 2581900, 2620260, 2658620,
+	1613000, 1653000, 1693000, 1733000, 1773000, 1813000,
+	1853000, 1893000, 1933000, 1973000, 2013000, 2053000,
+};
+
+/*
+ * Poll the TMCC lock of the current system, i2c_lock is dropped while
+ * sleeping. A carrier without AGC lock after CXD2878_SCAN_AGC_MS is
+ * given up early.
+ */
+static bool cxd2878_scan_wait(struct cxd2878_dev *dev, unsigned int timeout_ms)
+{
+	unsigned long start = jiffies;
+	bool s3 = dev->system == SONY_DTV_SYSTEM_ISDBS3;
+	u8 data[3];
+
+	for (;;) {
+		cxd2878_wr(dev, dev->slvt, 0x00, 0xa0);
+		if (cxd2878_rdm(dev, dev->slvt, 0x10, data, 3))
+			return false;
+		if (s3 ? (data[1] & 0x80) : (data[2] & 0x20))
+			return true;
+		if (!(data[0] & 0x20) &&
+		    time_after(jiffies, start + msecs_to_jiffies(CXD2878_SCAN_AGC_MS)))
+			return false;
+		if (time_after(jiffies, start + msecs_to_jiffies(timeout_ms)))
+			return false;
+
+		mutex_unlock(&dev->base->i2c_lock);
+		msleep(10);
+		mutex_lock(&dev->base->i2c_lock);
+	}
+}
+
+static int cxd2878_scan_tune(struct cxd2878_dev *dev, u32 frequency, bool s3)
+{
+	int ret;
+
+	ret = s3 ? cxd2878_set_isdbs3(&dev->fe, 0) :
+		   cxd2878_set_isdbs(&dev->fe, 0);
+	if (ret)
+		return ret;
+
+	ret = cxd2878_gate_get(dev);
+	if (!ret)
+		ret = cxd2857_tune(dev, frequency);
+	cxd2878_gate_put(dev);
+	ret |= cxd2878_tuneEnd(dev);
+
+	return ret;
+}
+
+/*
+ * Tune every frequency of freqs (the BS/CS plan if NULL) as ISDB-S, then
+ * as ISDB-S3, and return each carrier that locks. For ISDB-S3 the TMCC
+ * lists every stream id of the carrier, so no stream has to be tuned on
+ * its own. ISDB-S carriers come back without stream ids, see
+ * cxd2857_get_tmcc(). Returns -EBUSY while the frontend is in use; the
+ * demodulator is put back to sleep afterwards.
+ */
+int cxd2857_scan(struct dvb_frontend *fe, const u32 *freqs, int nr_freqs,
+		 struct cxd2857_scan_entry *res, int max)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+	int i, n = 0, ret;
+
+	if (!freqs) {
+		freqs = cxd2878_sat_plan;
+		nr_freqs = ARRAY_SIZE(cxd2878_sat_plan);
+	}
+
+	mutex_lock(&dev->base->i2c_lock);
+	ret = cxd2878_scan_begin(dev);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < nr_freqs && n < max; i++) {
+		ret = cxd2878_scan_tune(dev, freqs[i], false);
+		if (ret)
+			goto err;
+		if (cxd2878_scan_wait(dev, CXD2878_SCAN_ISDBS_MS)) {
+			/* no ISDB-S TMCC decode, only the carrier is reported */
+			memset(&res[n].tmcc, 0, sizeof(res[n].tmcc));
+			res[n++].frequency = freqs[i];
+			continue;
+		}
+
+		ret = cxd2878_scan_tune(dev, freqs[i], true);
+		if (ret)
+			goto err;
+		if (cxd2878_scan_wait(dev, CXD2878_SCAN_ISDBS3_MS) &&
+		    !cxd2878_get_isdbs3_tmcc(fe, &res[n].tmcc))
+			res[n++].frequency = freqs[i];
+	}
+	ret = n;
+err:
+	cxd2878_scan_end(dev);
+out:
+	mutex_unlock(&dev->base->i2c_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(cxd2857_scan);
+
+/* reading the file scans the BS/CS plan, -EBUSY while the frontend is in use */
+static int cxd2878_scan_show(struct seq_file *s, void *unused)
+{
+	struct cxd2878_dev *dev = s->private;
+	struct cxd2857_scan_entry *res;
+	int i, j, n;
+
+	res = kcalloc(ARRAY_SIZE(cxd2878_sat_plan), sizeof(*res), GFP_KERNEL);
+	if (!res)
+		return -ENOMEM;
+
+	n = cxd2857_scan(&dev->fe, NULL, 0, res, ARRAY_SIZE(cxd2878_sat_plan));
+	for (i = 0; i < n; i++) {
+		if (!res[i].tmcc.isdbs3) {
+			seq_printf(s, "%u ISDB-S streams unsupported\n",
+				   res[i].frequency);
+			continue;
+		}
+		seq_printf(s, "%u ISDB-S3", res[i].frequency);
+		for (j = 0; j < res[i].tmcc.nr_streams; j++)
+			if (res[i].tmcc.streams.stream_info[j].stream_id &&
+			    res[i].tmcc.streams.stream_info[j].stream_id != 0xffff)
+				seq_printf(s, " 0x%04x",
+					   res[i].tmcc.streams.stream_info[j].stream_id);
+		seq_putc(s, '\n');
+	}
+	kfree(res);
+
+	return n < 0 ? n : 0;
+}
+
+static int cxd2878_scan_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cxd2878_scan_show, inode->i_private);
+}
+
+static const struct file_operations cxd2878_scan_fops = {
+	.owner   = THIS_MODULE,
+	.open    = cxd2878_scan_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static u32 cxd2878_uhf_frequency(int ch)
+{
+	/* 473 + 1/7 MHz for channel 13, 6 MHz raster */
+	return 473142857 + (ch - CXD2878_SCAN_UHF_FIRST) * 6000000;
+}
+
+/* wait for TS lock, give up as soon as the demodulator detects no signal */
+static bool cxd2878_scan_wait_isdbt(struct cxd2878_dev *dev)
+{
+	unsigned long timeout = jiffies + msecs_to_jiffies(CXD2878_SCAN_ISDBT_MS);
+	u8 data;
+
+	for (;;) {
+		cxd2878_wr(dev, dev->slvt, 0x00, 0x60);
+		if (cxd2878_rdm(dev, dev->slvt, 0x10, &data, 1) ||
+		    (data & 0x10))
+			return false;
+		if ((data & 0x03) == 0x03)
+			return true;
+		if (time_after(jiffies, timeout))
+			return false;
+
+		mutex_unlock(&dev->base->i2c_lock);
+		msleep(20);
+		mutex_lock(&dev->base->i2c_lock);
+	}
+}
+
+/*
+ * ISDB-T scan of UHF channels 13-62. A first pass only programs the
+ * tuner and reads its RF level, with the demodulator left alone; only
+ * the channels above isdbt_scan_rssi_dbm are then tuned and waited for
+ * lock. Returns the number of locked channels, or -EBUSY while the
+ * frontend is in use; the demodulator is put back to sleep afterwards.
+ */
+int cxd2857_scan_isdbt(struct dvb_frontend *fe,
+		       struct cxd2857_isdbt_scan_entry *res, int max)
+{
+	struct cxd2878_dev *dev = fe->demodulator_priv;
+	struct dtv_frontend_properties *c = &fe->dtv_property_cache;
+	int nr = CXD2878_SCAN_UHF_LAST - CXD2878_SCAN_UHF_FIRST + 1;
+	s32 *level, rssi;
+	int ch, n = 0, ret;
+
+	level = kcalloc(nr, sizeof(*level), GFP_KERNEL);
+	if (!level)
+		return -ENOMEM;
+
+	mutex_lock(&dev->base->i2c_lock);
+	ret = cxd2878_scan_begin(dev);
+	if (ret)
+		goto out;
+
+	c->bandwidth_hz = 6000000;
+	ret = cxd2878_set_isdbt(fe);
+	if (ret)
+		goto err;
+
+	/*
+	 * RF level pass. The repeater is released and i2c_lock dropped while
+	 * the tuner settles, as in scan_wait, so the other tuners on the bus
+	 * are not held off for the whole sweep.
+	 */
+	for (ch = 0; ch < nr; ch++) {
+		u32 frequency = cxd2878_uhf_frequency(CXD2878_SCAN_UHF_FIRST + ch);
+
+		ret = cxd2878_gate_get(dev);
+		if (!ret)
+			ret = cxd2857_tune(dev, frequency);
+		cxd2878_gate_put(dev);
+		if (ret)
+			goto err;
+
+		mutex_unlock(&dev->base->i2c_lock);
+		msleep(CXD2878_SCAN_RSSI_MS);
+		mutex_lock(&dev->base->i2c_lock);
+
+		if (cxd2878_gate_get(dev) ||
+		    cxd2857_read_rssi_isdbt(dev, frequency / 1000, &rssi))
+			level[ch] = S32_MIN;
+		else
+			level[ch] = rssi * 10 - 4500;
+		cxd2878_gate_put(dev);
+	}
+
+	/* lock pass on the occupied channels only */
+	for (ch = 0; ch < nr && n < max; ch++) {
+		u32 frequency = cxd2878_uhf_frequency(CXD2878_SCAN_UHF_FIRST + ch);
+
+		if (level[ch] < isdbt_scan_rssi_dbm * 1000)
+			continue;
+
+		ret = cxd2878_set_isdbt(fe);
+		ret |= cxd2878_gate_get(dev);
+		if (!ret)
+			ret = cxd2857_tune(dev, frequency);
+		cxd2878_gate_put(dev);
+		ret |= cxd2878_tuneEnd(dev);
+		if (ret)
+			goto err;
+
+		if (cxd2878_scan_wait_isdbt(dev)) {
+			res[n].frequency = frequency;
+			res[n].strength = level[ch];
+			n++;
+		}
+	}
+	ret = n;
+err:
+	cxd2878_scan_end(dev);
+out:
+	mutex_unlock(&dev->base->i2c_lock);
+	kfree(level);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(cxd2857_scan_isdbt);
+
+/* reading the file scans UHF, the frontend must not be in use */
+static int cxd2878_scan_isdbt_show(struct seq_file *s, void *unused)
+{
+	struct cxd2878_dev *dev = s->private;
+	struct cxd2857_isdbt_scan_entry *res;
+	int max = CXD2878_SCAN_UHF_LAST - CXD2878_SCAN_UHF_FIRST + 1;
+	int i, n;
+
+	res = kcalloc(max, sizeof(*res), GFP_KERNEL);
+	if (!res)
+		return -ENOMEM;
+
+	n = cxd2857_scan_isdbt(&dev->fe, res, max);
+	for (i = 0; i < n; i++)
+		seq_printf(s, "%u %d\n", res[i].frequency, res[i].strength);
+	kfree(res);
+
+	return n < 0 ? n : 0;
+}
+
+static int cxd2878_scan_isdbt_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cxd2878_scan_isdbt_show, inode->i_private);
+}
+
+static const struct file_operations cxd2878_scan_isdbt_fops = {
+	.owner   = THIS_MODULE,
+	.open    = cxd2878_scan_isdbt_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
 static struct cxd_base *match_base(struct i2c_adapter *i2c, u8 adr)
 {
 	struct cxd_base *p;
@@ -2686,6 +3588,7 @@ struct dvb_frontend *cxd2857_attach(const struct cxd2857_config *config,
 
 	u16 id;
 	u8 data[2];
+	char name[32];
 	dev = kzalloc(sizeof(struct cxd2878_dev), GFP_KERNEL);
 	if (!dev)
 		goto err;
@@ -2695,6 +3598,10 @@ struct dvb_frontend *cxd2857_attach(const struct cxd2857_config *config,
 	dev->slvr = config->addr_slvt - 0x20;
 	dev->slvm = config->addr_slvt - 0x54;
 	dev->tuner_addr = config->tuner_addr;
+	cxd2878_regcache_invalidate(dev);
+	INIT_DELAYED_WORK(&dev->stats_work, cxd2878_stats_work);
+	INIT_DELAYED_WORK(&dev->gate_work, cxd2878_gate_work);
+	cxd2878_reset_stats(dev);
 
 	dev->state = SONY_DEMOD_STATE_UNKNOWN;
 	dev->system = SONY_DTV_SYSTEM_UNKNOWN;
@@ -2731,14 +3638,17 @@ struct dvb_frontend *cxd2857_attach(const struct cxd2857_config *config,
 	memcpy(&dev->fe.ops, &cxd2878_ops, sizeof(struct dvb_frontend_ops));
 	dev->fe.demodulator_priv = dev;
 
+	mutex_lock(&cxdlist_lock);
 	base = match_base(i2c, config->addr_slvt);
 	if (base) {
 		base->count++;
 		dev->base = base;
 	} else {
 		base = kzalloc(sizeof(struct cxd_base), GFP_KERNEL);
-		if (!base)
+		if (!base) {
+			mutex_unlock(&cxdlist_lock);
 			goto err1;
+		}
 		base->i2c = i2c;
 		base->config = *config;
 		base->adr = config->addr_slvt;
@@ -2747,6 +3657,7 @@ struct dvb_frontend *cxd2857_attach(const struct cxd2857_config *config,
 		dev->base = base;
 		list_add(&base->cxdlist, &cxdlist);
 	}
+	mutex_unlock(&cxdlist_lock);
 	cxd2878_wr(dev, dev->slvx, 0x00, 0x00);
 	cxd2878_rdm(dev, dev->slvx, 0xFB, &data[0], 1);
 	cxd2878_rdm(dev, dev->slvx, 0xFD, &data[1], 1);
@@ -2765,6 +3676,16 @@ struct dvb_frontend *cxd2857_attach(const struct cxd2857_config *config,
 	}
 	dev->chipid = id;
 
+	snprintf(name, sizeof(name), "cxd2857-i2c%d-%02x", i2c_adapter_id(i2c),
+		 dev->slvt);
+	dev->debugfs = debugfs_create_dir(name, NULL);
+	debugfs_create_file("tmcc", 0444, dev->debugfs, dev,
+			    &cxd2878_tmcc_fops);
+	debugfs_create_file("scan", 0400, dev->debugfs, dev,
+			    &cxd2878_scan_fops);
+	debugfs_create_file("scan_isdbt", 0400, dev->debugfs, dev,
+			    &cxd2878_scan_isdbt_fops);
+
 	dev_dbg(&i2c->dev, "%s: attaching frontend successfully.\n",
 		KBUILD_MODNAME);
 
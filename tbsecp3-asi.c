@@ -1,103 +1,93 @@
+#include <linux/iopoll.h>
 
 #include "tbsecp3.h"
 
-u8 asi_CheckFree(struct tbsecp3_dev *dev,int asi_base_addr, unsigned char OpbyteNum)
-	{
-		unsigned char tmpbuf[4];
-		int i;
-		int j=500;
-		if(OpbyteNum==2)
-			j=400;
-		else if(OpbyteNum==1)
-			j=200;	
-		//pauseThread(OpbyteNum+1);
-	
-		tmpbuf[0] = 0;
-		for(i=0;(i<j) && (tmpbuf[0] != 1);i++)
-		{
-			*(u32 *)tmpbuf = tbs_read(asi_base_addr, ASI_STATUS );  
-		}
-		//return (tmpbuf[0] == 1);
-	
-		if(tmpbuf[0] == 1)
-			return true;
-		else
-		{
-			printk("----------asi spi interface check error! %x\n",tmpbuf[0]);
-			return false;
-		} 
-	}
-
+/* one 16 bit SPI register access takes a few us, allow for a slow chip */
+#define ASI_SPI_POLL_US		10
+#define ASI_SPI_TIMEOUT_US	10000
 
-bool asi_chip_reset(struct tbsecp3_dev *dev,int asi_base_addr)
+/*
+ * Wait for the SPI engine to go idle. The caller sleeps between status
+ * reads instead of spinning on MMIO.
+ */
+int asi_wait_free(struct tbsecp3_dev *dev, int asi_base_addr)
 {
-	unsigned char tmpbuf[4];
-
-	tmpbuf[0] = 0;
-	tbs_write( asi_base_addr, ASI_CHIP_RST, *(u32 *)&tmpbuf[0]);
+	u32 status;
+	int ret;
+
+	ret = read_poll_timeout(tbsecp3_read, status, (status & 0xff) == 1,
+				ASI_SPI_POLL_US, ASI_SPI_TIMEOUT_US, false,
+				dev, asi_base_addr + ASI_STATUS);
+	if (ret)
+		dev_err(&dev->pci_dev->dev,
+			"asi spi interface timeout, status %02x\n", status & 0xff);
+	return ret;
+}
 
+int asi_chip_reset(struct tbsecp3_dev *dev, int asi_base_addr)
+{
+	tbs_write(asi_base_addr, ASI_CHIP_RST, 0);
 	msleep(20);
-
-	tmpbuf[0] = 1;
-	tbs_write( asi_base_addr, ASI_CHIP_RST, *(u32 *)&tmpbuf[0]);
-	
+	tbs_write(asi_base_addr, ASI_CHIP_RST, 1);
 	msleep(100);
-	return true ;
+	return 0;
 }
-int asi_read16bit(struct tbsecp3_dev *dev,int asi_base_addr,int reg_addr)
-{
-	unsigned char tmpbuf[4];
-	int regData;
-
-	tmpbuf[0] = (unsigned char) (reg_addr>>8)&0xff; //read_address, msb first;
-	tmpbuf[1] = (unsigned char)(reg_addr&0xff);
-	tmpbuf[0] += 0x80;  //read data;
 
-	
-	tbs_write( asi_base_addr, ASI_SPI_CMD, *(u32 *)&tmpbuf[0]);
-	
-	tmpbuf[0] = 0xf0;	//cs low,cs high, write, read;	
-	tmpbuf[1] = 0x20;	// 2 bytes command for writing;
-    tmpbuf[1] += 0x02;	 //read 2 bytes data;
-	tbs_write( asi_base_addr, ASI_SPI_CONFIG, *(u32 *)&tmpbuf[0]);
+int asi_read16bit(struct tbsecp3_dev *dev, int asi_base_addr, int reg_addr,
+		  u16 *val)
+{
+	u32 data;
+	int ret;
 
-	if(asi_CheckFree(dev,asi_base_addr,2)== false)
-	{
-		printk(" spi_read16bit error!\n");
-		return false;	
-	}                   
+	/* read command, address msb first */
+	data = (((reg_addr >> 8) & 0xff) | 0x80) | (reg_addr & 0xff) << 8;
+	tbs_write(asi_base_addr, ASI_SPI_CMD, data);
 
-	*(u32 *)tmpbuf =  tbs_read(asi_base_addr, ASI_SPI_RD_32 ); 
+	/* cs low, cs high, write, read; 2 command bytes, 2 data bytes */
+	tbs_write(asi_base_addr, ASI_SPI_CONFIG, 0xf0 | 0x22 << 8);
 
-	regData = ((tmpbuf[0]<<8) | tmpbuf[1]);
+	ret = asi_wait_free(dev, asi_base_addr);
+	if (ret)
+		return ret;
 
-	return regData;
+	data = tbs_read(asi_base_addr, ASI_SPI_RD_32);
+	*val = (data & 0xff) << 8 | ((data >> 8) & 0xff);
+	return 0;
 }
 
-bool asi_write16bit(struct tbsecp3_dev *dev,int asi_base_addr, int reg_addr, int data16bit)
+int asi_write16bit(struct tbsecp3_dev *dev, int asi_base_addr, int reg_addr,
+		   u16 val)
 {
-	unsigned char tmpbuf[4];
-	int regData;
-
-	tmpbuf[0] = (unsigned char) (reg_addr>>8)&0xff; //read_address, msb first;
-	tmpbuf[1] = (unsigned char)(reg_addr&0xff);
-
-	tmpbuf[2] = (unsigned char) (data16bit>>8)&0xff; //read_address, msb first;
-	tmpbuf[3] = (unsigned char)(data16bit&0xff);
-
-	tbs_write( asi_base_addr, ASI_SPI_CMD, *(u32 *)&tmpbuf[0]);
-	
-	tmpbuf[0] = 0xe0;	//cs low,cs high, write, no read;	
-	tmpbuf[1] = 0x40;	// 4 bytes command for writing;
-	tbs_write( asi_base_addr, ASI_SPI_CONFIG, *(u32 *)&tmpbuf[0]);
-
-	if(asi_CheckFree(dev,asi_base_addr,2)== false)
-	{
-		printk(" spi_write16bit error!\n");
-		return false;	
-	}                   
-	return true ;
-}
+	u32 data;
 
+	/* address then data, msb first */
+	data = ((reg_addr >> 8) & 0xff) | (reg_addr & 0xff) << 8 |
+	       ((val >> 8) & 0xff) << 16 | (val & 0xff) << 24;
+	tbs_write(asi_base_addr, ASI_SPI_CMD, data);
 
+	/* cs low, cs high, write, no read; 4 command bytes */
+	tbs_write(asi_base_addr, ASI_SPI_CONFIG, 0xe0 | 0x40 << 8);
+
+	return asi_wait_free(dev, asi_base_addr);
+}
 
+/*
+ * Program a table of registers, issuing each write as soon as the
+ * previous one has completed. Stops at the first failed write.
+ */
+int asi_write_regs(struct tbsecp3_dev *dev, int asi_base_addr,
+		   const struct asi_reg *regs, int n)
+{
+	int i, ret;
+
+	for (i = 0; i < n; i++) {
+		ret = asi_write16bit(dev, asi_base_addr, regs[i].reg,
+				     regs[i].val);
+		if (ret) {
+			dev_err(&dev->pci_dev->dev,
+				"asi write reg %04x failed\n", regs[i].reg);
+			return ret;
+		}
+	}
+	return 0;
+}
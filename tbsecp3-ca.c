@@ -15,8 +15,82 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+/*
+ * CI slots of the TBS_DVB_EXTENSION boards. This file is not part of
+ * the TBS6812 build (see Makefile) and has not been compiled or tested
+ * in this tree.
+ */
+
+#include <linux/iopoll.h>
+
 #include "tbsecp3.h"
 
+static bool ca_ready_poll;
+module_param(ca_ready_poll, bool, 0644);
+MODULE_PARM_DESC(ca_ready_poll, "experimental: poll the assumed CA window ready flag instead of waiting 150us per access (default: off)");
+
+/*
+ * CA window status register, bit 0 is CAM presence. TBSECP3_CA_READY is
+ * an assumption, no FPGA documentation confirms that bit 1 signals a
+ * finished access. It is only used with ca_ready_poll=1, and the poll
+ * still gives up after the usual 150us.
+ */
+#define TBSECP3_CA_STAT		0x0c
+#define TBSECP3_CA_READY	BIT(1)
+
+/* EN 50221 command interface registers and bits */
+#define TBSECP3_CI_DATA		0
+#define TBSECP3_CI_CMDSTAT	1
+#define TBSECP3_CI_SIZE_LOW	2
+#define TBSECP3_CI_SIZE_HIGH	3
+#define TBSECP3_CI_HC		0x01
+#define TBSECP3_CI_RE		0x01
+#define TBSECP3_CI_WE		0x02
+#define TBSECP3_CI_FR		0x40
+#define TBSECP3_CI_DA		0x80
+
+/* time the CAM needs after reset, settle time after a presence change */
+#define TBSECP3_CA_RESET_MS	2800
+#define TBSECP3_CA_DEBOUNCE_MS	300
+
+/* wait for the CA window to finish an access, tbsca->lock held */
+static void tbsecp3_ca_wait(struct tbsecp3_dev *dev, struct tbsecp3_ca *tbsca)
+{
+	u32 val;
+
+	if (ca_ready_poll)
+		read_poll_timeout_atomic(tbsecp3_read, val,
+				val & TBSECP3_CA_READY, 1, 150, false, dev,
+				TBSECP3_CA_BASE(tbsca->nr) + TBSECP3_CA_STAT);
+	else
+		udelay(150);
+}
+
+static u8 __tbsecp3_ca_rd_ctrl(struct tbsecp3_dev *dev,
+	struct tbsecp3_ca *tbsca, u8 address)
+{
+	u32 data = 0;
+
+	data |= (address & 3) << 8;
+	data |= 0x02 << 16;
+	tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x00, data);
+	tbsecp3_ca_wait(dev, tbsca);
+
+	return tbs_read(TBSECP3_CA_BASE(tbsca->nr), 0x08) & 0xff;
+}
+
+static void __tbsecp3_ca_wr_ctrl(struct tbsecp3_dev *dev,
+	struct tbsecp3_ca *tbsca, u8 address, u8 value)
+{
+	u32 data = 0;
+
+	data |= (address & 3) << 8;
+	data |= 0x03 << 16;
+	data |= value << 24;
+	tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x00, data);
+	tbsecp3_ca_wait(dev, tbsca);
+}
+
 static int tbsecp3_ca_rd_attr_mem(struct dvb_ca_en50221 *ca,
 	int slot, int address)
 {
@@ -33,7 +107,7 @@ static int tbsecp3_ca_rd_attr_mem(struct dvb_ca_en50221 *ca,
 	data |= (address >> 8) & 0x7f;
 	data |= (address & 0xff) << 8;
 	tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x00, data);
-	udelay(150);
+	tbsecp3_ca_wait(dev, tbsca);
 
 	data = tbs_read(TBSECP3_CA_BASE(tbsca->nr), 0x04);
 
@@ -61,7 +135,7 @@ static int tbsecp3_ca_wr_attr_mem(struct dvb_ca_en50221 *ca,
 	data |= 0x01 << 16;
 	data |= value << 24;
 	tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x00, data);
-	udelay(150);
+	tbsecp3_ca_wait(dev, tbsca);
 
 	mutex_unlock(&tbsca->lock);
 
@@ -75,23 +149,16 @@ static int tbsecp3_ca_rd_cam_ctrl(struct dvb_ca_en50221 *ca,
 	struct tbsecp3_adapter *adapter =
 			(struct tbsecp3_adapter *) tbsca->adapter;
 	struct tbsecp3_dev *dev = adapter->dev;
-	u32 data = 0;
+	u8 data;
 
 	if (slot != 0)
 		return -EINVAL;
 
 	mutex_lock(&tbsca->lock);
-
-	data |= (address & 3) << 8;
-	data |= 0x02 << 16;
-	tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x00, data);
-	udelay(150);
-	
-	data = tbs_read(TBSECP3_CA_BASE(tbsca->nr), 0x08);
-
+	data = __tbsecp3_ca_rd_ctrl(dev, tbsca, address);
 	mutex_unlock(&tbsca->lock);
 
-	return (data & 0xff);
+	return data;
 }
 
 static int tbsecp3_ca_wr_cam_ctrl(struct dvb_ca_en50221 *ca, int slot,
@@ -101,24 +168,121 @@ static int tbsecp3_ca_wr_cam_ctrl(struct dvb_ca_en50221 *ca, int slot,
 	struct tbsecp3_adapter *adapter =
 			(struct tbsecp3_adapter *) tbsca->adapter;
 	struct tbsecp3_dev *dev = adapter->dev;
-	u32 data = 0;
 
 	if (slot != 0)
 		return -EINVAL;
 
 	mutex_lock(&tbsca->lock);
+	__tbsecp3_ca_wr_ctrl(dev, tbsca, address, value);
+	mutex_unlock(&tbsca->lock);
 
-	data |= (address & 3) << 8;
-	data |= 0x03 << 16;
-	data |= value << 24;
-	tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x00, data);
-	udelay(150);
+	return 0;
+}
+
+/*
+ * Whole EN 50221 data transfers under one lock, instead of one
+ * read_cam_control/write_cam_control call per byte from dvb_ca.
+ */
+static int tbsecp3_ca_read_data(struct dvb_ca_en50221 *ca, int slot,
+	u8 *ebuf, int ecount)
+{
+	struct tbsecp3_ca *tbsca = ca->data;
+	struct tbsecp3_adapter *adapter =
+			(struct tbsecp3_adapter *) tbsca->adapter;
+	struct tbsecp3_dev *dev = adapter->dev;
+	u64 start = ktime_get_ns();
+	int i, size, ret;
 
+	if (slot != 0)
+		return -EINVAL;
+
+	mutex_lock(&tbsca->lock);
+
+	if (!(__tbsecp3_ca_rd_ctrl(dev, tbsca, TBSECP3_CI_CMDSTAT) &
+	      TBSECP3_CI_DA)) {
+		ret = 0;
+		goto out;
+	}
+
+	size = __tbsecp3_ca_rd_ctrl(dev, tbsca, TBSECP3_CI_SIZE_LOW);
+	size |= __tbsecp3_ca_rd_ctrl(dev, tbsca, TBSECP3_CI_SIZE_HIGH) << 8;
+	if (!size || size > ecount) {
+		ret = -EIO;
+		goto out;
+	}
+
+	for (i = 0; i < size; i++)
+		ebuf[i] = __tbsecp3_ca_rd_ctrl(dev, tbsca, TBSECP3_CI_DATA);
+
+	if (__tbsecp3_ca_rd_ctrl(dev, tbsca, TBSECP3_CI_CMDSTAT) &
+	    TBSECP3_CI_RE) {
+		ret = -EIO;
+		goto out;
+	}
+
+	tbsca->xfer_bytes += size;
+	tbsca->xfer_ns += ktime_get_ns() - start;
+	ret = size;
+out:
 	mutex_unlock(&tbsca->lock);
+	return ret;
+}
 
-	return 0;
+static int tbsecp3_ca_write_data(struct dvb_ca_en50221 *ca, int slot,
+	u8 *ebuf, int ecount)
+{
+	struct tbsecp3_ca *tbsca = ca->data;
+	struct tbsecp3_adapter *adapter =
+			(struct tbsecp3_adapter *) tbsca->adapter;
+	struct tbsecp3_dev *dev = adapter->dev;
+	u64 start = ktime_get_ns();
+	int i, ret;
+
+	if (slot != 0)
+		return -EINVAL;
+
+	mutex_lock(&tbsca->lock);
+
+	/* the module has data for us first */
+	if (__tbsecp3_ca_rd_ctrl(dev, tbsca, TBSECP3_CI_CMDSTAT) &
+	    (TBSECP3_CI_DA | TBSECP3_CI_RE)) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	__tbsecp3_ca_wr_ctrl(dev, tbsca, TBSECP3_CI_CMDSTAT, TBSECP3_CI_HC);
+	if (!(__tbsecp3_ca_rd_ctrl(dev, tbsca, TBSECP3_CI_CMDSTAT) &
+	      TBSECP3_CI_FR)) {
+		ret = -EAGAIN;
+		goto out_hc;
+	}
+
+	__tbsecp3_ca_wr_ctrl(dev, tbsca, TBSECP3_CI_SIZE_HIGH, ecount >> 8);
+	__tbsecp3_ca_wr_ctrl(dev, tbsca, TBSECP3_CI_SIZE_LOW, ecount & 0xff);
+	for (i = 0; i < ecount; i++)
+		__tbsecp3_ca_wr_ctrl(dev, tbsca, TBSECP3_CI_DATA, ebuf[i]);
+
+	if (__tbsecp3_ca_rd_ctrl(dev, tbsca, TBSECP3_CI_CMDSTAT) &
+	    TBSECP3_CI_WE) {
+		ret = -EIO;
+		goto out_hc;
+	}
+
+	tbsca->xfer_bytes += ecount;
+	tbsca->xfer_ns += ktime_get_ns() - start;
+	ret = ecount;
+out_hc:
+	__tbsecp3_ca_wr_ctrl(dev, tbsca, TBSECP3_CI_CMDSTAT, 0);
+out:
+	mutex_unlock(&tbsca->lock);
+	return ret;
 }
 
+/*
+ * Pulse the reset line and return, the slot reports ready through
+ * poll_slot_status once TBSECP3_CA_RESET_MS have passed. The access lock
+ * is not held while waiting.
+ */
 static int tbsecp3_ca_slot_reset(struct dvb_ca_en50221 *ca, int slot)
 {
 	struct tbsecp3_ca *tbsca = ca->data;
@@ -128,16 +292,19 @@ static int tbsecp3_ca_slot_reset(struct dvb_ca_en50221 *ca, int slot)
 
 	if (slot != 0)
 		return -EINVAL;
-	
-	mutex_lock(&tbsca->lock);
 
+	mutex_lock(&tbsca->lock);
 	tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x04, 1);
-	msleep (10);
+	mutex_unlock(&tbsca->lock);
+
+	msleep(10);
 
+	mutex_lock(&tbsca->lock);
 	tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x04, 0);
-	msleep (2800);
+	tbsca->resetting = true;
+	tbsca->reset_done = jiffies + msecs_to_jiffies(TBSECP3_CA_RESET_MS);
+	mutex_unlock(&tbsca->lock);
 
-	mutex_unlock (&tbsca->lock);
 	return 0;
 }
 
@@ -177,6 +344,11 @@ static int tbsecp3_ca_slot_ts_enable(struct dvb_ca_en50221 *ca, int slot)
 	return tbsecp3_ca_slot_ctrl(ca, slot, 1);
 }
 
+/*
+ * A presence change switches the slot power and is only reported after
+ * TBSECP3_CA_DEBOUNCE_MS; the FPGA has no CAM interrupt, so both this and
+ * the reset delay are advanced from here by the dvb_ca thread polls.
+ */
 static int tbsecp3_ca_poll_slot_status(struct dvb_ca_en50221 *ca, 
 	int slot, int open)
 {
@@ -185,25 +357,38 @@ static int tbsecp3_ca_poll_slot_status(struct dvb_ca_en50221 *ca,
 			(struct tbsecp3_adapter *) tbsca->adapter;
 	struct tbsecp3_dev *dev = adapter->dev;
 	u32 data;
-	int ret;
+	int ret = 0;
 
 	if (slot != 0)
 		return -EINVAL;
 
 	mutex_lock(&tbsca->lock);
 	data = tbs_read(TBSECP3_CA_BASE(tbsca->nr), 0x0c) & 1;
-	if (tbsca->status != data){
+	if (tbsca->status != data) {
+		if (!tbsca->debouncing) {
+			tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x08, !data);
+			tbsca->debouncing = true;
+			tbsca->debounce_done = jiffies +
+				msecs_to_jiffies(TBSECP3_CA_DEBOUNCE_MS);
+		} else if (time_after_eq(jiffies, tbsca->debounce_done)) {
+			tbsca->debouncing = false;
+			tbsca->status = data;
+		}
+	} else if (tbsca->debouncing) {
+		/* back to the old state before it settled */
 		tbs_write(TBSECP3_CA_BASE(tbsca->nr), 0x08, !data);
-		msleep(300);
-		tbsca->status = data;
+		tbsca->debouncing = false;
 	}
-	mutex_unlock(&tbsca->lock);
 
-	if (data & 1)
-		ret = DVB_CA_EN50221_POLL_CAM_PRESENT |
-		      DVB_CA_EN50221_POLL_CAM_READY;
-	else
-		ret = 0;
+	if (tbsca->resetting && time_after_eq(jiffies, tbsca->reset_done))
+		tbsca->resetting = false;
+
+	if (tbsca->status) {
+		ret = DVB_CA_EN50221_POLL_CAM_PRESENT;
+		if (!tbsca->resetting)
+			ret |= DVB_CA_EN50221_POLL_CAM_READY;
+	}
+	mutex_unlock(&tbsca->lock);
 
 	return ret;
 }
@@ -218,6 +403,8 @@ struct dvb_ca_en50221 ca_config = {
 	.slot_shutdown       = tbsecp3_ca_slot_shutdown,
 	.slot_ts_enable      = tbsecp3_ca_slot_ts_enable,
 	.poll_slot_status    = tbsecp3_ca_poll_slot_status,
+	.read_data           = tbsecp3_ca_read_data,
+	.write_data          = tbsecp3_ca_write_data,
 };
 
 
@@ -17,6 +17,9 @@
 
 #include "tbsecp3.h"
 
+#define CREATE_TRACE_POINTS
+#include "tbsecp3-trace.h"
+
 static bool enable_msi = true;
 module_param(enable_msi, bool, 0444);
 MODULE_PARM_DESC(enable_msi, "use an msi interrupt if available");
@@ -53,11 +56,15 @@ static irqreturn_t tbsecp3_irq_handler(int irq, void *dev_id)
 
 	tbs_write(TBSECP3_INT_BASE, TBSECP3_INT_STAT, stat);
 
+	trace_tbsecp3_irq(irq, stat);
+
 	if (stat & 0x000ffff0) {
 		/* dma0~15 */
 		for (i = 0; i < dev->info->adapters; i++) {
 			in = dev->adapter[i].cfg->ts_in;
 			if (stat & TBSECP3_DMA_IF(in)){
+				WRITE_ONCE(dev->adapter[i].dma.irq_ts, ktime_get_ns());
+				this_cpu_inc(dev->adapter[i].stats->irqs);
 				tasklet_schedule(&dev->adapter[i].tasklet);
 				}
 		}
@@ -78,9 +85,52 @@ static irqreturn_t tbsecp3_irq_handler(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+#ifndef TBS_DVB_EXTENSION
+static void tbsecp3_adapters_attach_work(struct work_struct *work)
+{
+	struct tbsecp3_i2c *bus = container_of(work, struct tbsecp3_i2c,
+					       attach_work);
+	struct tbsecp3_dev *dev = bus->dev;
+	int i;
+
+	for (i = 0; i < dev->info->adapters; i++)
+		if (dev->adapter[i].i2c == bus)
+			tbsecp3_dvb_attach_frontend(&dev->adapter[i]);
+}
+
+/*
+ * Frontend detection resets and probes the chips with long delays.
+ * Run it in parallel for each i2c bus before the adapters are registered.
+ */
+static void tbsecp3_adapters_attach_frontends(struct tbsecp3_dev *dev)
+{
+	int i;
+
+	for (i = 0; i < TBSECP3_MAX_I2C_BUS; i++) {
+		INIT_WORK(&dev->i2c_bus[i].attach_work,
+			  tbsecp3_adapters_attach_work);
+		queue_work(system_unbound_wq, &dev->i2c_bus[i].attach_work);
+	}
+	for (i = 0; i < TBSECP3_MAX_I2C_BUS; i++)
+		flush_work(&dev->i2c_bus[i].attach_work);
+}
+#else
+/*
+ * Extension boards register CA devices on the adapter while attaching,
+ * so their frontends are attached from tbsecp3_dvb_init.
+ */
+static void tbsecp3_adapters_attach_frontends(struct tbsecp3_dev *dev)
+{
+}
+#endif
+
 static int tbsecp3_adapters_attach(struct tbsecp3_dev *dev)
 {
 	int i, ret = 0;
+
+	/* register the adapters in order so their numbers do not depend on timing */
+	tbsecp3_adapters_attach_frontends(dev);
+
 	for (i = 0; i < dev->info->adapters; i++) {
 		ret = tbsecp3_dvb_init(&dev->adapter[i]);
 		if (ret) {
@@ -172,6 +222,7 @@ static bool tbsecp3_enable_msi(struct pci_dev *pci_dev, struct tbsecp3_dev *dev)
 static int tbsecp3_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 {
 	struct tbsecp3_dev *dev;
+	ktime_t start = ktime_get();
 	int ret = -ENODEV;
 
 	if (pci_enable_device(pdev) < 0)
@@ -239,10 +290,13 @@ static int tbsecp3_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 	ret = tbsecp3_adapters_attach(dev);
 	if (ret < 0)
 		goto err5;
+
+	tbsecp3_debugfs_init(dev);
 	
-	dev_info(&pdev->dev, "%s: PCI %s, IRQ %d, MMIO 0x%lx\n",
+	dev_info(&pdev->dev, "%s: PCI %s, IRQ %d, MMIO 0x%lx, probed in %lld ms\n",
 		dev->info->name, pci_name(pdev), pdev->irq,
-		(unsigned long) pci_resource_start(pdev, 0));
+		(unsigned long) pci_resource_start(pdev, 0),
+		ktime_ms_delta(ktime_get(), start));
 
 	//dev_info(&dev->pci_dev->dev, "%s ready\n", dev->info->name);
 	return 0;
@@ -276,6 +330,8 @@ static void tbsecp3_remove(struct pci_dev *pdev)
 {
 	struct tbsecp3_dev *dev = pci_get_drvdata(pdev);
 
+	tbsecp3_debugfs_exit(dev);
+
 	/* disable interrupts */
 	tbs_write(TBSECP3_INT_BASE, TBSECP3_INT_EN, 0); 
 	free_irq(pdev->irq, dev);
@@ -293,13 +349,59 @@ static void tbsecp3_remove(struct pci_dev *pdev)
 	kfree(dev);
 }
 
+static int tbsecp3_suspend(struct pci_dev *pdev, pm_message_t state)
+{
+	struct tbsecp3_dev *dev = pci_get_drvdata(pdev);
+	struct tbsecp3_adapter *adapter;
+	int i;
+
+	for (i = 0; i < dev->info->adapters; i++) {
+		adapter = &dev->adapter[i];
+		if (adapter->nr == -1)
+			continue;
+
+		if (adapter->fe)
+			dvb_frontend_suspend(adapter->fe);
+		/* feeds are kept, streaming restarts on resume */
+		if (adapter->feeds)
+			tbsecp3_dma_disable(adapter);
+	}
+
+	/* disable interrupts */
+	tbs_write(TBSECP3_INT_BASE, TBSECP3_INT_EN, 0);
+	synchronize_irq(pdev->irq);
+	tbsecp3_adapters_release(dev);
+
+	pci_save_state(pdev);
+	pci_set_power_state(pdev, pci_choose_state(pdev, state));
+	return 0;
+}
+
 static int tbsecp3_resume(struct pci_dev *pdev)
 {
 	struct tbsecp3_dev *dev = pci_get_drvdata(pdev);
+	struct tbsecp3_adapter *adapter;
+	int i;
+
+	pci_set_power_state(pdev, PCI_D0);
+	pci_restore_state(pdev);
+
 	/* re-init registers */
+	tbs_write(TBSECP3_INT_BASE, TBSECP3_INT_STAT, 0xff);
 	tbsecp3_i2c_reg_init(dev);
 	tbsecp3_dma_reg_init(dev);
 	tbs_write(TBSECP3_INT_BASE, TBSECP3_INT_EN, 1);
+
+	for (i = 0; i < dev->info->adapters; i++) {
+		adapter = &dev->adapter[i];
+		if (adapter->nr == -1)
+			continue;
+
+		if (adapter->fe)
+			dvb_frontend_resume(adapter->fe);
+		if (adapter->feeds)
+			tbsecp3_dma_enable(adapter);
+	}
 	return 0;
 }
 
@@ -387,10 +489,14 @@ static struct pci_driver tbsecp3_driver = {
 	.name = "TBS6812 driver",
 #endif
 	.id_table = tbsecp3_id_table,
+	.driver   = {
+		/* several cards probe at the same time */
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+	},
 	.probe    = tbsecp3_probe,
 	.remove   = tbsecp3_remove,
 	.resume   = tbsecp3_resume,
-	.suspend  = NULL,
+	.suspend  = tbsecp3_suspend,
 };
 
 module_pci_driver(tbsecp3_driver);
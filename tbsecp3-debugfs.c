@@ -0,0 +1,265 @@
+/*
+    TBS ECP3 FPGA based cards PCIe driver
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <linux/seq_file.h>
+#include <linux/vmalloc.h>
+
+#include "tbsecp3.h"
+
+static int tbsecp3_pid_errors_show(struct seq_file *s, void *unused)
+{
+	struct tbsecp3_pid_counters *cnt = s->private;
+	int pid;
+
+	seq_printf(s, "packets    %u\n", cnt->packets);
+	seq_printf(s, "sync_loss  %u\n", cnt->sync_loss);
+	seq_puts(s, "pid     cc_errors  tei_errors\n");
+	for_each_set_bit(pid, cnt->active, TBSECP3_PID_COUNT)
+		seq_printf(s, "0x%04x %10u %11u\n", pid,
+			   cnt->cc_errors[pid], cnt->tei_errors[pid]);
+	return 0;
+}
+
+/*
+ * Reading the file returns the counters since the last read and resets
+ * them. The tasklet is only held off while the counters are swapped for
+ * the zeroed spare; they are printed and cleared outside adap_lock.
+ */
+static int tbsecp3_pid_errors_open(struct inode *inode, struct file *file)
+{
+	struct tbsecp3_adapter *adapter = inode->i_private;
+	struct tbsecp3_pid_stats *ps = adapter->pid_stats;
+	struct tbsecp3_pid_counters *fresh, *snap;
+	int ret;
+
+	spin_lock_bh(&adapter->adap_lock);
+	fresh = ps->spare;
+	ps->spare = NULL;
+	spin_unlock_bh(&adapter->adap_lock);
+
+	/* another reader holds the spare */
+	if (!fresh)
+		fresh = vzalloc(sizeof(struct tbsecp3_pid_counters));
+	if (!fresh)
+		return -ENOMEM;
+
+	spin_lock_bh(&adapter->adap_lock);
+	snap = ps->cnt;
+	ps->cnt = fresh;
+	spin_unlock_bh(&adapter->adap_lock);
+
+	ret = single_open(file, tbsecp3_pid_errors_show, snap);
+	if (ret)
+		vfree(snap);
+	return ret;
+}
+
+/* clear the counters that were read and keep them as the next spare */
+static int tbsecp3_pid_errors_release(struct inode *inode, struct file *file)
+{
+	struct tbsecp3_adapter *adapter = inode->i_private;
+	struct tbsecp3_pid_stats *ps = adapter->pid_stats;
+	struct seq_file *s = file->private_data;
+	struct tbsecp3_pid_counters *snap = s->private;
+	int pid;
+
+	for_each_set_bit(pid, snap->active, TBSECP3_PID_COUNT) {
+		snap->cc_errors[pid] = 0;
+		snap->tei_errors[pid] = 0;
+	}
+	bitmap_zero(snap->active, TBSECP3_PID_COUNT);
+	snap->packets = 0;
+	snap->sync_loss = 0;
+
+	spin_lock_bh(&adapter->adap_lock);
+	if (!ps->spare) {
+		ps->spare = snap;
+		snap = NULL;
+	}
+	spin_unlock_bh(&adapter->adap_lock);
+
+	vfree(snap);
+	return single_release(inode, file);
+}
+
+static const struct file_operations tbsecp3_pid_errors_fops = {
+	.owner   = THIS_MODULE,
+	.open    = tbsecp3_pid_errors_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = tbsecp3_pid_errors_release,
+};
+
+/* one line per log2 bucket: lower bound in us, sample count */
+static void tbsecp3_stats_show_hist(struct seq_file *s, const char *name,
+				    const u64 *hist)
+{
+	int i;
+
+	seq_printf(s, "%s_us\n", name);
+	for (i = 0; i < TBSECP3_HIST_BUCKETS; i++)
+		seq_printf(s, "  %6u %llu\n", i ? 1U << (i - 1) : 0, hist[i]);
+}
+
+static int tbsecp3_stats_show(struct seq_file *s, void *unused)
+{
+	struct tbsecp3_adapter *adapter = s->private;
+	struct tbsecp3_adap_stats sum, *st;
+	int cpu, i;
+
+	memset(&sum, 0, sizeof(sum));
+	for_each_possible_cpu(cpu) {
+		st = per_cpu_ptr(adapter->stats, cpu);
+		sum.irqs += st->irqs;
+		sum.tasklets += st->tasklets;
+		sum.buffers += st->buffers;
+		sum.bytes += st->bytes;
+		sum.resyncs += st->resyncs;
+		sum.overruns += st->overruns;
+		for (i = 0; i < TBSECP3_HIST_BUCKETS; i++) {
+			sum.latency_hist[i] += st->latency_hist[i];
+			sum.runtime_hist[i] += st->runtime_hist[i];
+		}
+	}
+
+	seq_printf(s, "irqs      %llu\n", sum.irqs);
+	seq_printf(s, "tasklets  %llu\n", sum.tasklets);
+	seq_printf(s, "buffers   %llu\n", sum.buffers);
+	seq_printf(s, "bytes     %llu\n", sum.bytes);
+	seq_printf(s, "resyncs   %llu\n", sum.resyncs);
+	seq_printf(s, "overruns  %llu\n", sum.overruns);
+	tbsecp3_stats_show_hist(s, "irq_latency", sum.latency_hist);
+	tbsecp3_stats_show_hist(s, "tasklet_runtime", sum.runtime_hist);
+	return 0;
+}
+
+static int tbsecp3_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tbsecp3_stats_show, inode->i_private);
+}
+
+static const struct file_operations tbsecp3_stats_fops = {
+	.owner   = THIS_MODULE,
+	.open    = tbsecp3_stats_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static int tbsecp3_i2c_stats_show(struct seq_file *s, void *unused)
+{
+	struct tbsecp3_dev *dev = s->private;
+	struct tbsecp3_i2c *bus;
+	u64 polled, slept, wait_ns;
+	int i;
+
+	seq_puts(s, "bus     polled      slept  avg_wait_us\n");
+	for (i = 0; i < TBSECP3_MAX_I2C_BUS; i++) {
+		bus = &dev->i2c_bus[i];
+
+		mutex_lock(&bus->lock);
+		polled = bus->polled;
+		slept = bus->slept;
+		wait_ns = bus->wait_ns;
+		mutex_unlock(&bus->lock);
+
+		seq_printf(s, "%3d %10llu %10llu %12llu\n", i, polled, slept,
+			   polled + slept ?
+			   div64_u64(wait_ns, (polled + slept) * NSEC_PER_USEC) : 0);
+	}
+	return 0;
+}
+
+static int tbsecp3_i2c_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tbsecp3_i2c_stats_show, inode->i_private);
+}
+
+static const struct file_operations tbsecp3_i2c_stats_fops = {
+	.owner   = THIS_MODULE,
+	.open    = tbsecp3_i2c_stats_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static int tbsecp3_ca_stats_show(struct seq_file *s, void *unused)
+{
+	struct tbsecp3_ca *tbsca = s->private;
+	u64 bytes, ns;
+
+	mutex_lock(&tbsca->lock);
+	bytes = tbsca->xfer_bytes;
+	ns = tbsca->xfer_ns;
+	mutex_unlock(&tbsca->lock);
+
+	seq_printf(s, "bytes        %llu\n", bytes);
+	seq_printf(s, "time_us      %llu\n", div_u64(ns, NSEC_PER_USEC));
+	seq_printf(s, "bytes_per_s  %llu\n",
+		   ns ? div64_u64(bytes * NSEC_PER_SEC, ns) : 0);
+	return 0;
+}
+
+static int tbsecp3_ca_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tbsecp3_ca_stats_show, inode->i_private);
+}
+
+static const struct file_operations tbsecp3_ca_stats_fops = {
+	.owner   = THIS_MODULE,
+	.open    = tbsecp3_ca_stats_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+void tbsecp3_debugfs_init(struct tbsecp3_dev *dev)
+{
+	struct tbsecp3_adapter *adapter;
+	char name[32];
+	int i;
+
+	snprintf(name, sizeof(name), "tbsecp3-%s", pci_name(dev->pci_dev));
+	dev->debugfs = debugfs_create_dir(name, NULL);
+
+	debugfs_create_file("i2c_stats", 0444, dev->debugfs, dev,
+			    &tbsecp3_i2c_stats_fops);
+
+	for (i = 0; i < dev->info->adapters; i++) {
+		adapter = &dev->adapter[i];
+
+		snprintf(name, sizeof(name), "adapter%d", i);
+		adapter->debugfs = debugfs_create_dir(name, dev->debugfs);
+
+		debugfs_create_file("stats", 0444, adapter->debugfs,
+				    adapter, &tbsecp3_stats_fops);
+
+		if (adapter->pid_stats)
+			debugfs_create_file("pid_errors", 0444, adapter->debugfs,
+					    adapter, &tbsecp3_pid_errors_fops);
+
+		if (adapter->tbsca)
+			debugfs_create_file("ca_stats", 0444, adapter->debugfs,
+					    adapter->tbsca, &tbsecp3_ca_stats_fops);
+	}
+}
+
+void tbsecp3_debugfs_exit(struct tbsecp3_dev *dev)
+{
+	debugfs_remove_recursive(dev->debugfs);
+	dev->debugfs = NULL;
+}
@@ -0,0 +1,71 @@
+/*
+    TBS ECP3 FPGA based cards PCIe driver
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * DMA ring walk and TS resync used by the DMA tasklet. Only depends on
+ * <linux/types.h> so the same code can be built outside the kernel. The
+ * userspace replay harness and benchmark that would do so are not part
+ * of this tree yet.
+ */
+
+#ifndef _TBSECP3_DMA_RING_H_
+#define _TBSECP3_DMA_RING_H_
+
+#include <linux/types.h>
+
+#define TBSECP3_DMA_BUFFERS	16
+#define TBSECP3_DMA_PRE_BUFFERS	2
+
+#define TS_PACKET_SIZE		188
+
+/* first buffer the hardware has not completed, from TBSECP3_DMA_STAT */
+static inline __u32 tbsecp3_ring_next(__u32 dma_stat)
+{
+	return (dma_stat - TBSECP3_DMA_PRE_BUFFERS + 1) &
+	       (TBSECP3_DMA_BUFFERS - 1);
+}
+
+static inline __u32 tbsecp3_ring_advance(__u32 buffer)
+{
+	return (buffer + 1) & (TBSECP3_DMA_BUFFERS - 1);
+}
+
+/* the hardware has caught up with the buffers not read yet */
+static inline int tbsecp3_ring_overrun(__u32 read_buffer, __u32 next_buffer)
+{
+	return ((next_buffer - read_buffer) & (TBSECP3_DMA_BUFFERS - 1)) >=
+	       TBSECP3_DMA_BUFFERS - TBSECP3_DMA_PRE_BUFFERS;
+}
+
+/*
+ * Find the sync byte offset with crude force (this might fail!).
+ * Returns the offset, or -1 when no aligned sync pattern was seen.
+ */
+static inline int tbsecp3_ts_find_sync(const __u8 *data)
+{
+	int i;
+
+	for (i = 0; i < TS_PACKET_SIZE; i++)
+		if (data[i] == 0x47 &&
+		    data[i + TS_PACKET_SIZE] == 0x47 &&
+		    data[i + 2 * TS_PACKET_SIZE] == 0x47 &&
+		    data[i + 4 * TS_PACKET_SIZE] == 0x47)
+			return i;
+	return -1;
+}
+
+#endif /* _TBSECP3_DMA_RING_H_ */
@@ -15,47 +15,113 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <linux/vmalloc.h>
+
 #include "tbsecp3.h"
+#include "tbsecp3-trace.h"
 
 static unsigned int dma_pkts[16] = {128, 128, 128, 128, 128, 128, 128, 128,128, 128, 128, 128, 128, 128, 128, 128};
 module_param_array(dma_pkts, int, NULL, 0444); /* No /sys/module write access */
 MODULE_PARM_DESC(dma_pkts, "DMA buffer size in TS packets (16-256), default 128");
 
-#define TS_PACKET_SIZE		188
+static bool pid_stats;
+module_param(pid_stats, bool, 0444);
+MODULE_PARM_DESC(pid_stats, "per-PID continuity counter and TEI error accounting in debugfs (default: off)");
+
+DEFINE_STATIC_KEY_FALSE(tbsecp3_pid_stats_key);
+
+static void tbsecp3_dma_pid_account(struct tbsecp3_pid_stats *ps,
+				    const u8 *data, u32 pkts)
+{
+	struct tbsecp3_pid_counters *cnt = ps->cnt;
+	const u8 *pkt;
+	u16 pid;
+	u8 afc, cc;
+	u32 i;
+
+	for (i = 0; i < pkts; i++) {
+		pkt = data + i * TS_PACKET_SIZE;
+		if (pkt[0] != 0x47) {
+			cnt->sync_loss++;
+			continue;
+		}
+		cnt->packets++;
+
+		pid = ((pkt[1] & 0x1f) << 8) | pkt[2];
+		if (pkt[1] & 0x80) {
+			/* transport_error_indicator, the rest is not trusted */
+			cnt->tei_errors[pid]++;
+			__set_bit(pid, cnt->active);
+			continue;
+		}
+		if (pid == 0x1fff)
+			continue;
+
+		afc = (pkt[3] >> 4) & 0x03;
+		cc = pkt[3] & 0x0f;
+
+		/* discontinuity_indicator */
+		if ((afc & 0x02) && pkt[4] && (pkt[5] & 0x80))
+			__clear_bit(pid, ps->seen);
+
+		/* the counter only advances on packets with payload */
+		if (!(afc & 0x01))
+			continue;
+
+		if (__test_and_set_bit(pid, ps->seen) &&
+		    cc != ps->last_cc[pid] &&
+		    cc != ((ps->last_cc[pid] + 1) & 0x0f)) {
+			cnt->cc_errors[pid]++;
+			__set_bit(pid, cnt->active);
+		}
+		ps->last_cc[pid] = cc;
+	}
+}
+
+static inline u32 tbsecp3_hist_bucket(u64 ns)
+{
+	return min_t(u32, fls64(div_u64(ns, 1000)), TBSECP3_HIST_BUCKETS - 1);
+}
 
 static void tbsecp3_dma_tasklet(unsigned long adap)
 {
 	struct tbsecp3_adapter *adapter = (struct tbsecp3_adapter *) adap;
 	struct tbsecp3_dev *dev = adapter->dev;
+	struct tbsecp3_adap_stats *stats;
 	u32 read_buffer, next_buffer;
+	u64 start, now;
 	u8* data;
 	int i;
 
+	start = ktime_get_ns();
+
 	spin_lock(&adapter->adap_lock);
 
+	stats = this_cpu_ptr(adapter->stats);
+	stats->tasklets++;
+
+	next_buffer = tbsecp3_ring_next(tbs_read(adapter->dma.base, TBSECP3_DMA_STAT));
+
 	if (adapter->dma.cnt < TBSECP3_DMA_PRE_BUFFERS)
 	{
-		next_buffer = (tbs_read(adapter->dma.base, TBSECP3_DMA_STAT) - TBSECP3_DMA_PRE_BUFFERS + 1) & (TBSECP3_DMA_BUFFERS - 1);
 		adapter->dma.cnt++;
 	}
         else
         {
-		next_buffer = (tbs_read(adapter->dma.base, TBSECP3_DMA_STAT) - TBSECP3_DMA_PRE_BUFFERS + 1) & (TBSECP3_DMA_BUFFERS - 1);
 		read_buffer = (u32)adapter->dma.next_buffer;
 
+		if (tbsecp3_ring_overrun(read_buffer, next_buffer))
+			stats->overruns++;
+
 		while (read_buffer != next_buffer)
 		{
 			data = adapter->dma.buf[read_buffer];
 
 			if (!adapter->cfg->tlv_dma && data[adapter->dma.offset] != 0x47) {
-			/* Find sync byte offset with crude force (this might fail!) */
-				for (i = 0; i < TS_PACKET_SIZE; i++)
-					if ((data[i] == 0x47) &&
-					(data[i + TS_PACKET_SIZE] == 0x47) &&
-					(data[i + 2 * TS_PACKET_SIZE] == 0x47) &&
-					(data[i + 4 * TS_PACKET_SIZE] == 0x47)) {
-						adapter->dma.offset = i;
-						break;
+				i = tbsecp3_ts_find_sync(data);
+				if (i >= 0) {
+					adapter->dma.offset = i;
+					stats->resyncs++;
 				}
 			}
 
@@ -67,16 +133,29 @@ static void tbsecp3_dma_tasklet(unsigned long adap)
 						adapter->dma.buf[0], adapter->dma.offset);
 				}
 			}
+			if (static_branch_unlikely(&tbsecp3_pid_stats_key) &&
+			    adapter->pid_stats && data[0] == 0x47)
+				tbsecp3_dma_pid_account(adapter->pid_stats,
+					data, adapter->dma.buffer_pkts);
+
 			if (adapter->cfg->tlv_dma)
 				dvb_dmx_swfilter_raw(&adapter->demux, data, adapter->dma.buffer_size);
 			else
 				dvb_dmx_swfilter_packets(&adapter->demux, data, adapter->dma.buffer_pkts);
-			read_buffer = (read_buffer + 1) & (TBSECP3_DMA_BUFFERS - 1);
+			now = ktime_get_ns() - READ_ONCE(adapter->dma.irq_ts);
+			trace_tbsecp3_dma_buffer(adapter->nr, read_buffer,
+				adapter->dma.buffer_size, now);
+			stats->buffers++;
+			stats->bytes += adapter->dma.buffer_size;
+			stats->latency_hist[tbsecp3_hist_bucket(now)]++;
+			read_buffer = tbsecp3_ring_advance(read_buffer);
 		}
 	}
 
 	adapter->dma.next_buffer = (u8)next_buffer;
 
+	stats->runtime_hist[tbsecp3_hist_bucket(ktime_get_ns() - start)]++;
+
 	spin_unlock(&adapter->adap_lock);
 
 }
@@ -125,9 +204,22 @@ void tbsecp3_dma_reg_init(struct tbsecp3_dev *dev)
 
 void tbsecp3_dma_free(struct tbsecp3_dev *dev)
 {
-	struct tbsecp3_adapter *adapter = dev->adapter;
+	struct tbsecp3_adapter *adapter;
 	int i;
 	for (i = 0; i < dev->info->adapters; i++) {
+		adapter = &dev->adapter[i];
+
+		free_percpu(adapter->stats);
+		adapter->stats = NULL;
+
+		if (adapter->pid_stats) {
+			static_branch_dec(&tbsecp3_pid_stats_key);
+			vfree(adapter->pid_stats->cnt);
+			vfree(adapter->pid_stats->spare);
+			vfree(adapter->pid_stats);
+			adapter->pid_stats = NULL;
+		}
+
 		if (adapter->dma.buf[0] == NULL)
 			continue;
 
@@ -135,7 +227,6 @@ void tbsecp3_dma_free(struct tbsecp3_dev *dev)
 			adapter->dma.page_size + 0x100,
 			adapter->dma.buf[0], adapter->dma.dma_addr);
 		adapter->dma.buf[0] = NULL;
-		adapter++;
 	}
 }
 
@@ -170,6 +261,23 @@ int tbsecp3_dma_init(struct tbsecp3_dev *dev)
 		for (j = 1; j < TBSECP3_DMA_BUFFERS + 1; j++)
 			adapter->dma.buf[j] = adapter->dma.buf[j-1] + adapter->dma.buffer_size;
 
+		adapter->stats = alloc_percpu(struct tbsecp3_adap_stats);
+		if (!adapter->stats)
+			goto err;
+
+		if (pid_stats) {
+			adapter->pid_stats = vzalloc(sizeof(struct tbsecp3_pid_stats));
+			if (!adapter->pid_stats)
+				goto err;
+			static_branch_inc(&tbsecp3_pid_stats_key);
+			adapter->pid_stats->cnt =
+				vzalloc(sizeof(struct tbsecp3_pid_counters));
+			adapter->pid_stats->spare =
+				vzalloc(sizeof(struct tbsecp3_pid_counters));
+			if (!adapter->pid_stats->cnt || !adapter->pid_stats->spare)
+				goto err;
+		}
+
 		tasklet_init(&adapter->tasklet, tbsecp3_dma_tasklet, (unsigned long) adapter);
 		spin_lock_init(&adapter->adap_lock);
 		adapter++;
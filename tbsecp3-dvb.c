@@ -1388,6 +1388,11 @@ static struct cxd2878_config tbs6590se_cfg[] = {
 		.rf_port = 1,
 		}		
 	};
+
+/* TBS690a ASI chip setup, written once per adapter at attach */
+static const struct asi_reg tbs690a_asi_regs[] = {
+	{ 0x24, 3 },
+};
 #endif
 
 static struct cxd2857_config tbs6812_cfg[] = {
@@ -1465,6 +1470,7 @@ static void tbs6590se_reset_demod(struct tbsecp3_adapter *adapter) //for the cxd
 	
 	return ;
 }
+
 static int tbsecp3_frontend_attach(struct tbsecp3_adapter *adapter)
 {
 	struct tbsecp3_dev *dev = adapter->dev;
@@ -1964,27 +1970,15 @@ static int tbsecp3_frontend_attach(struct tbsecp3_adapter *adapter)
 		    goto frontend_atach_fail;
 
 		// init asi
-		int regdata;
-		u8 mpbuf[4];
-		mpbuf[0] = adapter->nr; //0--3 select value
-		tbs_write( TBSECP3_GPIO_BASE, 0x34 , *(u32 *)&mpbuf[0]); // select chip : 13*8 =104=0x68 select address
-		//u32 mpbuf = adapter->nr;
-		//tbs_write( TBSECP3_GPIO_BASE, 0x34 , mpbuf); // select chip : 13*8 =104=0x68 select address
-		// ==***********************************************************************
-
-		asi_chip_reset(dev,ASI0_BASEADDRESS);  //asi chip reset;
-
-		mpbuf[0] = 1; //active spi bus from "z"
-		tbs_write( ASI0_BASEADDRESS, ASI_SPI_ENABLE, *(u32 *)&mpbuf[0]);
-
-		regdata = asi_read16bit(dev,ASI0_BASEADDRESS,0x24);
-		asi_write16bit(dev,ASI0_BASEADDRESS,0x24,3);	 
-		regdata = asi_read16bit(dev,ASI0_BASEADDRESS, 0x24);
-
-		mpbuf[0] = 0; //spi disable, enter "z" state;
-		tbs_write( ASI0_BASEADDRESS, ASI_SPI_ENABLE, *(u32 *)&mpbuf[0]);
-
-		//==****************************************************************************************
+		tbs_write(TBSECP3_GPIO_BASE, 0x34, adapter->nr); // select chip 0--3
+		asi_chip_reset(dev, ASI0_BASEADDRESS);
+
+		tbs_write(ASI0_BASEADDRESS, ASI_SPI_ENABLE, 1); // active spi bus from "z"
+		if (asi_write_regs(dev, ASI0_BASEADDRESS, tbs690a_asi_regs,
+				   ARRAY_SIZE(tbs690a_asi_regs)))
+			dev_warn(&dev->pci_dev->dev, "asi %d init failed\n",
+				 adapter->nr);
+		tbs_write(ASI0_BASEADDRESS, ASI_SPI_ENABLE, 0); // spi disable, enter "z" state
 		// ~~init asi
 		break;
 
@@ -2610,6 +2604,16 @@ frontend_atach_fail:
 	return -ENODEV;
 }
 
+/*
+ * Probe the demodulator and tuner of an adapter. This is the slow part
+ * of the adapter setup and does not touch the dvb core, so it may run
+ * for adapters on different i2c buses at the same time.
+ */
+int tbsecp3_dvb_attach_frontend(struct tbsecp3_adapter *adapter)
+{
+    return tbsecp3_frontend_attach(adapter);
+}
+
 int tbsecp3_dvb_init(struct tbsecp3_adapter *adapter)
 {
     struct tbsecp3_dev *dev = adapter->dev;
@@ -2619,8 +2623,11 @@ int tbsecp3_dvb_init(struct tbsecp3_adapter *adapter)
     struct dvb_frontend *fe;
     struct dmx_frontend *fe_hw;
     struct dmx_frontend *fe_mem;
+    u8 mac[6];
     int ret;
 
+    /* the frontend attach may have read the MAC, registration clears it */
+    memcpy(mac, adap->proposed_mac, sizeof(mac));
     ret = dvb_register_adapter(adap, "TBSECP3 DVB Adapter",
             THIS_MODULE,
             &adapter->dev->pci_dev->dev,
@@ -2631,8 +2638,9 @@ int tbsecp3_dvb_init(struct tbsecp3_adapter *adapter)
             dev_err(&dev->pci_dev->dev,
                     "increase DVB_MAX_ADAPTERS (%d)\n",
                     DVB_MAX_ADAPTERS);
-        return ret;
+        goto err_detach;
     }
+    memcpy(adap->proposed_mac, mac, sizeof(mac));
 
     adap->priv = adapter;
     dvbdemux->priv = adapter;
@@ -2692,7 +2700,9 @@ int tbsecp3_dvb_init(struct tbsecp3_adapter *adapter)
         goto err5;
     }
 
-    tbsecp3_frontend_attach(adapter);
+    /* usually attached beforehand by tbsecp3_dvb_attach_frontend */
+    if (adapter->fe == NULL)
+        tbsecp3_frontend_attach(adapter);
     if (adapter->fe == NULL) {
         dev_err(&dev->pci_dev->dev, "frontend attach failed\n");
         ret = -ENODEV;
@@ -2708,24 +2718,22 @@ int tbsecp3_dvb_init(struct tbsecp3_adapter *adapter)
     ret = dvb_register_frontend(adap, adapter->fe);
     if (ret < 0) {
         dev_err(&dev->pci_dev->dev, "frontend register failed\n");
-        goto err7;
+        goto err6;
     }
 
     if (adapter->fe2 != NULL) {
         ret = dvb_register_frontend(adap, adapter->fe2);
         if (ret < 0) {
             dev_err(&dev->pci_dev->dev, "frontend2 register failed\n");
+            dvb_unregister_frontend(adapter->fe);
+            goto err6;
         }
     }
 
 
     return ret;
 
-err7:
-    dvb_frontend_detach(adapter->fe);
 err6:
-    tbsecp3_release_sec(adapter->fe);
-
     dvb_net_release(&adapter->dvbnet);
 err5:
     dvbdemux->dmx.close(&dvbdemux->dmx);
@@ -2739,6 +2747,19 @@ err1:
     dvb_dmx_release(dvbdemux);
 err0:
     dvb_unregister_adapter(adap);
+err_detach:
+    /* attached before registration, tbsecp3_dvb_exit is not called on failure */
+    tbsecp3_i2c_remove_clients(adapter);
+    if (adapter->fe) {
+        tbsecp3_release_sec(adapter->fe);
+        dvb_frontend_detach(adapter->fe);
+        adapter->fe = NULL;
+    }
+    if (adapter->fe2) {
+        tbsecp3_release_sec(adapter->fe2);
+        dvb_frontend_detach(adapter->fe2);
+        adapter->fe2 = NULL;
+    }
     return ret;
 }
 
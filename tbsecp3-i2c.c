@@ -16,6 +16,11 @@
 */
 
 #include "tbsecp3.h"
+#include "tbsecp3-trace.h"
+
+static unsigned int i2c_poll_max_us = 200;
+module_param(i2c_poll_max_us, uint, 0644);
+MODULE_PARM_DESC(i2c_poll_max_us, "busy-wait for i2c chunks expected to complete within this time, 0 always sleeps (default: 200)");
 
 union tbsecp3_i2c_ctrl {
 	struct {
@@ -33,6 +38,43 @@ union tbsecp3_i2c_ctrl {
 	} bits;
 };
 
+/*
+ * Wait for the completion interrupt of a chunk of len data bytes.
+ * Short chunks finish in a few tens of microseconds, much less than a
+ * sleep/wake round trip, so spin on the flag set by the interrupt
+ * handler for the expected wire time and only then go to sleep.
+ */
+static int tbsecp3_i2c_wait(struct tbsecp3_i2c *bus, u16 len)
+{
+	u64 start = ktime_get_ns();
+	u64 budget;
+	int ret;
+
+	/* address + data bytes with ack, start and stop, 50% margin */
+	budget = (u64)bus->bit_ns * (9 * (len + 1) + 2);
+	budget += budget / 2;
+
+	if (budget <= (u64)i2c_poll_max_us * NSEC_PER_USEC) {
+		while (ktime_get_ns() - start < budget) {
+			if (READ_ONCE(bus->done)) {
+				bus->polled++;
+				bus->wait_ns += ktime_get_ns() - start;
+				return 1;
+			}
+			cpu_relax();
+		}
+	}
+
+	ret = wait_event_timeout(bus->wq, bus->done == 1, HZ);
+	bus->slept++;
+	bus->wait_ns += ktime_get_ns() - start;
+	return ret;
+}
+
+/*
+ * All messages run back to back under the bus lock, a nack or timeout
+ * aborts the rest so callers may queue whole register sequences.
+ */
 static int i2c_xfer(struct i2c_adapter *adapter, struct i2c_msg *msg, int num)
 {
 	struct tbsecp3_i2c *bus = i2c_get_adapdata(adapter);
@@ -41,6 +83,7 @@ static int i2c_xfer(struct i2c_adapter *adapter, struct i2c_msg *msg, int num)
 	int i, j, retval;
 	u16 len, remaining, xfer_max;
 	u8 *b;
+	u64 start;
 
 	mutex_lock(&bus->lock);
 	//clear the i2c status	
@@ -50,6 +93,7 @@ static int i2c_xfer(struct i2c_adapter *adapter, struct i2c_msg *msg, int num)
 
 		b = msg[i].buf;
 		remaining = msg[i].len;
+		start = ktime_get_ns();
 
 		i2c_ctrl.raw.ctrl = 0;
 		i2c_ctrl.bits.start = 1;
@@ -76,9 +120,13 @@ static int i2c_xfer(struct i2c_adapter *adapter, struct i2c_msg *msg, int num)
 			}
 			bus->done = 0;
 			tbs_write(bus->base, TBSECP3_I2C_CTRL, i2c_ctrl.raw.ctrl);
-			retval = wait_event_timeout(bus->wq, bus->done == 1, HZ);
+			retval = tbsecp3_i2c_wait(bus, len);
 			if (retval == 0) {
 				tbs_read(bus->base, TBSECP3_I2C_STAT); // restore iic to its original state
+				trace_tbsecp3_i2c_xfer(bus->nr, msg[i].addr,
+					msg[i].flags, msg[i].len,
+					ktime_get_ns() - start,
+					TBSECP3_I2C_XFER_TIMEOUT);
 				dev_err(&dev->pci_dev->dev, "i2c xfer timeout\n");
 				retval = -EIO;
 				goto i2c_xfer_exit;
@@ -86,7 +134,13 @@ static int i2c_xfer(struct i2c_adapter *adapter, struct i2c_msg *msg, int num)
 
 			j = tbs_read(bus->base, TBSECP3_I2C_CTRL);
 			if (j & 0x04) {
-				dev_err(&dev->pci_dev->dev, "i2c nack (%x)\n", j);
+				trace_tbsecp3_i2c_xfer(bus->nr, msg[i].addr,
+					msg[i].flags, msg[i].len,
+					ktime_get_ns() - start,
+					TBSECP3_I2C_XFER_NACK);
+				dev_err(&dev->pci_dev->dev,
+					"i2c nack (%x) addr 0x%02x msg %d/%d\n",
+					j, msg[i].addr, i + 1, num);
 				retval = -EIO;
 				goto i2c_xfer_exit;
 			}
@@ -101,6 +155,9 @@ static int i2c_xfer(struct i2c_adapter *adapter, struct i2c_msg *msg, int num)
 			remaining -= len;
 		} while (remaining);
 
+		trace_tbsecp3_i2c_xfer(bus->nr, msg[i].addr, msg[i].flags,
+			msg[i].len, ktime_get_ns() - start, TBSECP3_I2C_XFER_OK);
+
 	}	
 	retval = num;
 i2c_xfer_exit:
@@ -180,6 +237,8 @@ void tbsecp3_i2c_reg_init(struct tbsecp3_dev *dev)
 		baud = 9;
 
 	for (i = 0; i < 4; i++) {
+		/* the bus runs at 4MHz / (baud + 1) */
+		dev->i2c_bus[i].bit_ns = (baud + 1) * 250;
 		tbs_write(dev->i2c_bus[i].base, TBSECP3_I2C_BAUD, baud);
 		tbs_read(dev->i2c_bus[i].base, TBSECP3_I2C_STAT);
 		tbs_write(TBSECP3_INT_BASE, TBSECP3_I2C_IE(i), 1);
@@ -194,6 +253,7 @@ int tbsecp3_i2c_init(struct tbsecp3_dev *dev)
 	for (i = 0; i < 4; i++) {
 		dev->i2c_bus[i].base = TBSECP3_I2C_BASE(i);
 		dev->i2c_bus[i].dev = dev;
+		dev->i2c_bus[i].nr = i;
 		ret = tbsecp3_i2c_register(&dev->i2c_bus[i]);
 		if (ret)
 			break;
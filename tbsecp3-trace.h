@@ -0,0 +1,110 @@
+/*
+    TBS ECP3 FPGA based cards PCIe driver
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tbsecp3
+
+#if !defined(_TBSECP3_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _TBSECP3_TRACE_H_
+
+#include <linux/i2c.h>
+#include <linux/tracepoint.h>
+
+#define TBSECP3_I2C_XFER_OK		0
+#define TBSECP3_I2C_XFER_NACK		1
+#define TBSECP3_I2C_XFER_TIMEOUT	2
+
+TRACE_EVENT(tbsecp3_irq,
+	TP_PROTO(int irq, u32 stat),
+	TP_ARGS(irq, stat),
+
+	TP_STRUCT__entry(
+		__field(int, irq)
+		__field(u32, stat)
+	),
+
+	TP_fast_assign(
+		__entry->irq = irq;
+		__entry->stat = stat;
+	),
+
+	TP_printk("irq=%d int_stat=0x%08x", __entry->irq, __entry->stat)
+);
+
+TRACE_EVENT(tbsecp3_dma_buffer,
+	TP_PROTO(int adapter, u32 index, u32 bytes, u64 latency_ns),
+	TP_ARGS(adapter, index, bytes, latency_ns),
+
+	TP_STRUCT__entry(
+		__field(int, adapter)
+		__field(u32, index)
+		__field(u32, bytes)
+		__field(u64, latency_ns)
+	),
+
+	TP_fast_assign(
+		__entry->adapter = adapter;
+		__entry->index = index;
+		__entry->bytes = bytes;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("adapter=%d buffer=%u bytes=%u irq_latency=%lluns",
+		  __entry->adapter, __entry->index, __entry->bytes,
+		  __entry->latency_ns)
+);
+
+TRACE_EVENT(tbsecp3_i2c_xfer,
+	TP_PROTO(int bus, u16 addr, u16 flags, u16 len, u64 duration_ns,
+		 int status),
+	TP_ARGS(bus, addr, flags, len, duration_ns, status),
+
+	TP_STRUCT__entry(
+		__field(int, bus)
+		__field(u16, addr)
+		__field(u16, flags)
+		__field(u16, len)
+		__field(u64, duration_ns)
+		__field(int, status)
+	),
+
+	TP_fast_assign(
+		__entry->bus = bus;
+		__entry->addr = addr;
+		__entry->flags = flags;
+		__entry->len = len;
+		__entry->duration_ns = duration_ns;
+		__entry->status = status;
+	),
+
+	TP_printk("bus=%d addr=0x%02x %s len=%u duration=%lluns %s",
+		  __entry->bus, __entry->addr,
+		  (__entry->flags & I2C_M_RD) ? "rd" : "wr",
+		  __entry->len, __entry->duration_ns,
+		  __print_symbolic(__entry->status,
+			{ TBSECP3_I2C_XFER_OK,		"ok" },
+			{ TBSECP3_I2C_XFER_NACK,	"nack" },
+			{ TBSECP3_I2C_XFER_TIMEOUT,	"timeout" }))
+);
+
+#endif /* _TBSECP3_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE tbsecp3-trace
+#include <trace/define_trace.h>
@@ -27,6 +27,9 @@
 #include <linux/pci.h>
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/jump_label.h>
+#include <linux/percpu.h>
 
 #include <media/dmxdev.h>
 #include <media/dvbdev.h>
@@ -37,6 +40,7 @@
 #include <media/dvb_net.h>
 
 #include "tbsecp3-regs.h"
+#include "tbsecp3-dma-ring.h"
 
 #define TBSECP3_VID		0x544d
 #define TBSECP3_PID		0x6178
@@ -106,8 +110,9 @@
 #define TBSECP3_GPIODEF_HIGH	(1)
 #define TBSECP3_GPIODEF_LOW	(2)
 
-#define TBSECP3_DMA_BUFFERS	16
-#define TBSECP3_DMA_PRE_BUFFERS	2
+#define TBSECP3_PID_COUNT	8192
+
+#define TBSECP3_HIST_BUCKETS	16
 
 
 struct tbsecp3_dev;
@@ -143,6 +148,7 @@ struct tbsecp3_board {
 
 struct tbsecp3_i2c {
 	struct tbsecp3_dev *dev;
+	int nr;
 	u32 base;
 
 	struct i2c_adapter i2c_adap;
@@ -151,6 +157,17 @@ struct tbsecp3_i2c {
 	struct mutex lock;
 	wait_queue_head_t wq;
 	bool done;
+
+	/* attaches the frontends on this bus at probe time */
+	struct work_struct attach_work;
+
+	/* wire time of one bit, ns */
+	u32 bit_ns;
+
+	/* completion statistics, protected by lock */
+	u64 polled;
+	u64 slept;
+	u64 wait_ns;
 };
 
 struct tbsecp3_dma_channel {
@@ -163,6 +180,44 @@ struct tbsecp3_dma_channel {
 	u8 offset;
 	u8 cnt;
 	u8 next_buffer;
+	/* time of the last dma interrupt, ns */
+	u64 irq_ts;
+};
+
+/* error counters since the last debugfs read */
+struct tbsecp3_pid_counters {
+	u32 packets;
+	u32 sync_loss;
+	/* PIDs with errors */
+	DECLARE_BITMAP(active, TBSECP3_PID_COUNT);
+	u32 cc_errors[TBSECP3_PID_COUNT];
+	u32 tei_errors[TBSECP3_PID_COUNT];
+};
+
+/* per-PID error accounting, only allocated with pid_stats=1 */
+struct tbsecp3_pid_stats {
+	/* PIDs whose last_cc is valid */
+	DECLARE_BITMAP(seen, TBSECP3_PID_COUNT);
+	u8 last_cc[TBSECP3_PID_COUNT];
+	/*
+	 * cnt is swapped for the zeroed spare by a debugfs read, both
+	 * pointers are protected by adap_lock
+	 */
+	struct tbsecp3_pid_counters *cnt;
+	struct tbsecp3_pid_counters *spare;
+};
+
+/* always-on per-cpu dma counters, summed up by the debugfs stats file */
+struct tbsecp3_adap_stats {
+	u64 irqs;
+	u64 tasklets;
+	u64 buffers;
+	u64 bytes;
+	u64 resyncs;
+	u64 overruns;
+	/* bucket n counts samples of [2^(n-1), 2^n) us, the last one is open */
+	u64 latency_hist[TBSECP3_HIST_BUCKETS];
+	u64 runtime_hist[TBSECP3_HIST_BUCKETS];
 };
 
 struct tbsecp3_ca {
@@ -173,6 +228,15 @@ struct tbsecp3_ca {
 	struct tbsecp3_adapter *adapter;
 	struct mutex lock;
 	int status;
+
+	/* slot state machines, advanced by poll_slot_status */
+	bool resetting;
+	unsigned long reset_done;	/* jiffies */
+	bool debouncing;
+	unsigned long debounce_done;	/* jiffies */
+	/* read_data/write_data throughput, protected by lock */
+	u64 xfer_bytes;
+	u64 xfer_ns;
 };
 
 struct tbsecp3_adapter {
@@ -203,6 +267,11 @@ struct tbsecp3_adapter {
 	spinlock_t adap_lock;
 	struct tasklet_struct tasklet;
 	struct tbsecp3_dma_channel dma;
+	struct tbsecp3_pid_stats *pid_stats;
+	struct tbsecp3_adap_stats __percpu *stats;
+
+	/* debugfs */
+	struct dentry *debugfs;
 
 	/* ca interface */
 	struct tbsecp3_ca *tbsca;
@@ -223,10 +292,28 @@ struct tbsecp3_dev {
 	struct tbsecp3_i2c i2c_bus[TBSECP3_MAX_I2C_BUS];
 	
 	u8 mac_num;
+
+	/* debugfs */
+	struct dentry *debugfs;
 };
 
-#define tbs_read(_b, _o)	readl(dev->lmmio + (_b + _o))
-#define tbs_write(_b, _o, _v)	writel((_v), dev->lmmio + (_b + _o))
+/*
+ * Every FPGA register access goes through these two helpers, so a
+ * software model of the register block only has to replace them. No
+ * such model exists in this tree.
+ */
+static inline u32 tbsecp3_read(struct tbsecp3_dev *dev, u32 addr)
+{
+	return readl(dev->lmmio + addr);
+}
+
+static inline void tbsecp3_write(struct tbsecp3_dev *dev, u32 addr, u32 val)
+{
+	writel(val, dev->lmmio + addr);
+}
+
+#define tbs_read(_b, _o)	tbsecp3_read(dev, (_b) + (_o))
+#define tbs_write(_b, _o, _v)	tbsecp3_write(dev, (_b) + (_o), (_v))
 
 
 /* tbsecp3-core.c */
@@ -243,14 +330,22 @@ extern void tbsecp3_i2c_remove_clients(struct tbsecp3_adapter *adapter);
 extern struct tbsecp3_board tbsecp3_boards[];
 
 /* tbspcie-dvb.c */
+extern int tbsecp3_dvb_attach_frontend(struct tbsecp3_adapter *adapter);
 extern int tbsecp3_dvb_init(struct tbsecp3_adapter *adapter);
 extern void tbsecp3_dvb_exit(struct tbsecp3_adapter *adapter);
 
 /* tbsecp3-asi.c */
-extern u8 asi_CheckFree(struct tbsecp3_dev *dev,int asi_base_addr, unsigned char OpbyteNum);
-extern bool asi_chip_reset(struct tbsecp3_dev *dev,int asi_base_addr);
-extern int asi_read16bit(struct tbsecp3_dev *dev,int asi_base_addr,int reg_addr);
-extern bool asi_write16bit(struct tbsecp3_dev *dev,int asi_base_addr, int reg_addr, int data16bit);
+struct asi_reg {
+	u16 reg;
+	u16 val;
+};
+
+extern int asi_wait_free(struct tbsecp3_dev *dev, int asi_base_addr);
+extern int asi_chip_reset(struct tbsecp3_dev *dev, int asi_base_addr);
+extern int asi_read16bit(struct tbsecp3_dev *dev, int asi_base_addr, int reg_addr, u16 *val);
+extern int asi_write16bit(struct tbsecp3_dev *dev, int asi_base_addr, int reg_addr, u16 val);
+extern int asi_write_regs(struct tbsecp3_dev *dev, int asi_base_addr,
+			  const struct asi_reg *regs, int n);
 
 /* tbsecp3-dma.c */
 extern int tbsecp3_dma_init(struct tbsecp3_dev *dev);
@@ -258,6 +353,11 @@ extern void tbsecp3_dma_free(struct tbsecp3_dev *dev);
 extern void tbsecp3_dma_reg_init(struct tbsecp3_dev *dev);
 extern void tbsecp3_dma_enable(struct tbsecp3_adapter *adap);
 extern void tbsecp3_dma_disable(struct tbsecp3_adapter *adap);
+DECLARE_STATIC_KEY_FALSE(tbsecp3_pid_stats_key);
+
+/* tbsecp3-debugfs.c */
+extern void tbsecp3_debugfs_init(struct tbsecp3_dev *dev);
+extern void tbsecp3_debugfs_exit(struct tbsecp3_dev *dev);
 
 /* tbsecp3-ca.c */
 int tbsecp3_ca_init(struct tbsecp3_adapter *adap, int nr);